@@ -2,12 +2,256 @@
 Author(s): 1. Hanzala B. Rehan
 Description: A simulated CPU Process Scheduling Algorithm using a Linked List.
 Date created: October 4th, 2024.
-Date last modified: October 5th, 2024.
+Date last modified: October 16th, 2026.
 */
 #include <iostream>
+#include <fstream>
+#include <iomanip>
 #include <string>
+#include <vector>
+#include <thread>
+#include <barrier>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(SCHED_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
 using namespace std;
 
+class PerfCounter {
+    // A hardware performance counter for the calling thread, opened with perf_event_open.
+    // When the kernel or the machine does not provide the event, the counter reads as -1.
+public:
+    int fd;  // perf event file descriptor (-1 if unavailable)
+
+    PerfCounter(uint32_t type, uint64_t config) {
+        // Constructor opening a disabled user-space-only counter for the given event.
+        fd = -1;
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    ~PerfCounter() {
+#ifdef __linux__
+        if (fd != -1) close(fd);
+#endif
+    }
+
+    void start() {
+        // Resets the counter to zero and starts counting.
+#ifdef __linux__
+        if (fd == -1) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    long long stop() {
+        /*
+        Desc: Stops counting and reads the count.
+        returns:
+        (long long): events counted since start(), or -1 if the counter is unavailable.
+        */
+#ifdef __linux__
+        if (fd == -1) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        if (::read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+#else
+        return -1;
+#endif
+    }
+
+    long long read() {
+        /*
+        Desc: Reads the running count without stopping the counter.
+        returns:
+        (long long): events counted since start(), or 0 if the counter is unavailable.
+        */
+#ifdef __linux__
+        long long count = 0;
+        if (fd == -1 || ::read(fd, &count, sizeof(count)) != sizeof(count)) return 0;
+        return count;
+#else
+        return 0;
+#endif
+    }
+};
+
+// Optional instrumentation of the scheduler's hot path. Build with -DSCHED_PROFILE to time every
+// round and every pick of cycle(); without it PROFILE_PHASE expands to nothing and costs nothing.
+#ifdef SCHED_PROFILE
+enum Phase { PHASE_ROUND, PHASE_PICK, NUM_PHASES };
+
+static const char* const PHASE_NAMES[NUM_PHASES] = {"round", "pick"};
+
+inline unsigned long long profileTicks() {
+    // Cycle-accurate time stamp where the CPU has one, nanoseconds otherwise.
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct PhaseStats {
+    // Aggregated measurements of one phase.
+    long long count = 0;              // Number of times the phase ran
+    long long ticks = 0;              // Total time spent in the phase
+    long long histogram[64] = {};     // Bucket k counts runs taking [2^k, 2^(k+1)) ticks
+    long long cache_misses = 0;       // Hardware counter totals, only kept for rounds
+    long long branch_misses = 0;
+    long long instructions = 0;
+
+    void merge(const PhaseStats& other) {
+        count += other.count;
+        ticks += other.ticks;
+        for (int k = 0; k < 64; k++) histogram[k] += other.histogram[k];
+        cache_misses += other.cache_misses;
+        branch_misses += other.branch_misses;
+        instructions += other.instructions;
+    }
+};
+
+class Profiler {
+    // Process-wide totals. Every thread merges its own statistics in when it exits, and the
+    // totals are dumped to cerr when the program exits.
+public:
+    mutex lock;
+    PhaseStats totals[NUM_PHASES];
+    bool counters = false;  // Whether any thread had hardware counters
+
+    static Profiler& global() {
+        static Profiler instance;
+        return instance;
+    }
+
+    ~Profiler() {
+        cerr << "Scheduler profile (times in "
+#if defined(__x86_64__) || defined(__i386__)
+             << "TSC ticks"
+#else
+             << "ns"
+#endif
+             << "):" << endl;
+        for (int p = 0; p < NUM_PHASES; p++) {
+            const PhaseStats& st = totals[p];
+            if (st.count == 0) continue;
+            cerr << "  " << PHASE_NAMES[p] << ": " << st.count << " runs, mean " << st.ticks / st.count;
+            if (p == PHASE_ROUND && counters) {
+                cerr << ", per round: " << st.instructions / st.count << " instructions, "
+                     << st.cache_misses / st.count << " cache misses, " << st.branch_misses / st.count
+                     << " branch misses";
+            }
+            cerr << endl;
+            for (int k = 0; k < 64; k++) {
+                if (st.histogram[k] == 0) continue;
+                cerr << "    [" << (1ULL << k) << ", " << (k < 63 ? to_string(1ULL << (k + 1)) : "inf")
+                     << "): " << st.histogram[k] << endl;
+            }
+        }
+    }
+};
+
+class ThreadProfile {
+    // Statistics and hardware counters of the calling thread, merged into the global totals
+    // when the thread exits.
+public:
+    PhaseStats stats[NUM_PHASES];
+    PerfCounter cache_misses;
+    PerfCounter branch_misses;
+    PerfCounter instructions;
+
+    ThreadProfile()
+#ifdef __linux__
+        : cache_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES),
+          branch_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES),
+          instructions(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS) {
+#else
+        : cache_misses(0, 0), branch_misses(0, 0), instructions(0, 0) {
+#endif
+        Profiler::global();  // Make sure the totals outlive this thread's statistics
+        cache_misses.start();
+        branch_misses.start();
+        instructions.start();
+    }
+
+    ~ThreadProfile() {
+        Profiler& prof = Profiler::global();
+        lock_guard<mutex> guard(prof.lock);
+        for (int p = 0; p < NUM_PHASES; p++) prof.totals[p].merge(stats[p]);
+        if (instructions.fd != -1) prof.counters = true;
+    }
+
+    static ThreadProfile& current() {
+        thread_local ThreadProfile instance;
+        return instance;
+    }
+};
+
+class PhaseTimer {
+    // Times the enclosing scope as one run of a phase. Rounds also read the hardware counters;
+    // picks only take time stamps, since a counter read per pick would cost more than the pick.
+public:
+    Phase phase;
+    ThreadProfile& profile;
+    unsigned long long begin;
+    long long cache_begin, branch_begin, instr_begin;
+
+    PhaseTimer(Phase Phase_) : phase(Phase_), profile(ThreadProfile::current()) {
+        if (phase == PHASE_ROUND) {
+            cache_begin = profile.cache_misses.read();
+            branch_begin = profile.branch_misses.read();
+            instr_begin = profile.instructions.read();
+        }
+        begin = profileTicks();
+    }
+
+    ~PhaseTimer() {
+        long long ticks = profileTicks() - begin;
+        PhaseStats& st = profile.stats[phase];
+        st.count++;
+        st.ticks += ticks;
+        st.histogram[ticks > 0 ? 63 - __builtin_clzll(ticks) : 0]++;
+        if (phase == PHASE_ROUND) {
+            st.cache_misses += profile.cache_misses.read() - cache_begin;
+            st.branch_misses += profile.branch_misses.read() - branch_begin;
+            st.instructions += profile.instructions.read() - instr_begin;
+        }
+    }
+};
+
+// Each use gets its own timer name, so nested phases do not shadow each other.
+#define PROFILE_CONCAT(a, b) a##b
+#define PROFILE_NAME(line) PROFILE_CONCAT(profile_timer_, line)
+#define PROFILE_PHASE(phase) PhaseTimer PROFILE_NAME(__LINE__)(phase)
+#else
+#define PROFILE_PHASE(phase)
+#endif
+
 class Process {
     // Defining a process class based on a linked list node.
 public:
@@ -15,14 +259,24 @@ public:
     string id;      // Process Id
     int exec_time;  // Total execution time
     int rem_time;   // Remaining execution time
-    Process* next;  // Pointer to the next process
+    int arrival;    // Scheduler cycle count at which the process arrived
+    int next;       // Table index of the next process (-1 if none)
 
-    Process(string process_id, int total_time) {
+    Process() {
+        // Default constructor for the empty slots of a table page.
+        exec_time = 0;
+        rem_time = 0;
+        arrival = 0;
+        next = -1;
+    }
+
+    Process(string process_id, int total_time, int arrival_cycle = 0) {
         // Constructor initializing all the variables.
         id = process_id;
         exec_time = total_time;
         rem_time = exec_time;
-        next = nullptr;
+        arrival = arrival_cycle;
+        next = -1;
     }
 
     void process(int cycle_time) {
@@ -45,6 +299,216 @@ public:
     }
 };
 
+class PageArena {
+    // Hands out memory for process table pages from 2 MB regions backed by huge pages when the
+    // system allows it. Regions are requested with MAP_HUGETLB first, then as ordinary memory
+    // advised with MADV_HUGEPAGE (transparent huge pages), then from the heap.
+    // Freed pages are kept for reuse; regions are only returned to the system at exit.
+public:
+    static const size_t REGION_SIZE = 2 * 1024 * 1024;  // One 2 MB huge page
+
+    size_t block_size;       // Size of each block handed out
+    vector<void*> free_list; // Blocks freed and ready for reuse
+    char* cursor;            // Next unused byte of the current region
+    char* limit;             // End of the current region
+    int hugetlb_regions;     // Regions backed by reserved huge pages (MAP_HUGETLB)
+    int thp_regions;         // Regions advised to use transparent huge pages
+    int heap_regions;        // Regions taken from the heap
+    mutex lock;              // Pages can be released by any thread sharing them
+
+    PageArena(size_t Block_size) {
+        // Constructor for an arena of equally sized blocks.
+        block_size = (Block_size + 63) / 64 * 64;  // Keep blocks cache-line aligned
+        cursor = nullptr;
+        limit = nullptr;
+        hugetlb_regions = 0;
+        thp_regions = 0;
+        heap_regions = 0;
+    }
+
+    void* allocate() {
+        /*
+        Desc: Returns a block, reusing a freed one or carving it from the current region.
+        */
+        lock_guard<mutex> guard(lock);
+        if (!free_list.empty()) {
+            void* block = free_list.back();
+            free_list.pop_back();
+            return block;
+        }
+        if (cursor == nullptr || cursor + block_size > limit) {
+            cursor = newRegion();
+            limit = cursor + REGION_SIZE;
+        }
+        void* block = cursor;
+        cursor += block_size;
+        return block;
+    }
+
+    void deallocate(void* block) {
+        /*
+        Desc: Returns a block to the arena for reuse.
+        */
+        lock_guard<mutex> guard(lock);
+        free_list.push_back(block);
+    }
+
+private:
+    char* newRegion() {
+        // Maps one 2 MB region, falling back step by step when huge pages are unavailable.
+#ifdef __linux__
+        void* region = mmap(nullptr, REGION_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED) {
+            hugetlb_regions++;
+            return (char*)region;
+        }
+        // Over-map so the region can be trimmed to a 2 MB boundary, which THP requires.
+        char* raw = (char*)mmap(nullptr, 2 * REGION_SIZE, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED) {
+            char* aligned = (char*)(((uintptr_t)raw + REGION_SIZE - 1) & ~(uintptr_t)(REGION_SIZE - 1));
+            if (aligned > raw) munmap(raw, aligned - raw);
+            munmap(aligned + REGION_SIZE, raw + REGION_SIZE - aligned);
+            madvise(aligned, REGION_SIZE, MADV_HUGEPAGE);
+            thp_regions++;
+            return aligned;
+        }
+#endif
+        heap_regions++;
+        return (char*)::operator new(REGION_SIZE, align_val_t(64));
+    }
+};
+
+class ProcessTable {
+    // Paged storage for the processes of a scheduler. Pages are reference counted, so copies of
+    // a table share every page until one of them writes to it (copy-on-write).
+public:
+    static const int PAGE_SIZE = 256;  // Number of processes per page
+    static bool huge_pages;            // Whether new pages come from the huge page arena
+
+    struct Page {
+        Process slots[PAGE_SIZE];  // Process records stored in this page
+        atomic<int> refs;          // Number of tables sharing this page
+        bool arena_backed;         // Whether the page lives in the huge page arena
+
+        Page() : refs(1), arena_backed(false) {}
+        Page(const Page& other) : refs(1), arena_backed(false) {
+            for (int i = 0; i < PAGE_SIZE; i++) slots[i] = other.slots[i];
+        }
+    };
+
+    vector<Page*> pages;  // Pages in index order
+    int size;             // Number of slots handed out so far
+
+    ProcessTable() {
+        size = 0;
+    }
+
+    ProcessTable(const ProcessTable& other) : pages(other.pages), size(other.size) {
+        // Copying a table only shares its pages; nothing is duplicated until a write.
+        for (Page* page : pages) page->refs.fetch_add(1);
+    }
+
+    ProcessTable(ProcessTable&& other) noexcept : pages(move(other.pages)), size(other.size) {
+        other.pages.clear();
+        other.size = 0;
+    }
+
+    ProcessTable& operator=(ProcessTable other) {
+        swap(pages, other.pages);
+        swap(size, other.size);
+        return *this;
+    }
+
+    ~ProcessTable() {
+        // Drop this table's reference to each page, freeing pages nobody else shares.
+        for (Page* page : pages) release(page);
+    }
+
+    const Process& get(int index) const {
+        /*
+        Desc: Read-only access to a process; never copies a page.
+        Parameters:
+            index (int): table index of the process.
+        */
+        return pages[index / PAGE_SIZE]->slots[index % PAGE_SIZE];
+    }
+
+    Process& at(int index) {
+        /*
+        Desc: Writable access to a process. If the page holding it is shared with another table,
+                this table first takes a private copy of that page.
+        Parameters:
+            index (int): table index of the process.
+        */
+        Page*& page = pages[index / PAGE_SIZE];
+        if (page->refs.load() > 1) {
+            Page* copy = newPage(page);
+            release(page);
+            page = copy;
+        }
+        return page->slots[index % PAGE_SIZE];
+    }
+
+    int add(const Process& process) {
+        /*
+        Desc: Stores a process in the next free slot, growing the table by a page when needed.
+        Parameters:
+            process (const Process&): the process to store.
+        returns:
+        (int): table index of the stored process.
+        */
+        if (size == (int)pages.size() * PAGE_SIZE) {
+            pages.push_back(newPage(nullptr));
+        }
+        int index = size++;
+        at(index) = process;
+        return index;
+    }
+
+    int sharedPages() const {
+        /*
+        Desc: Counts the pages this table still shares with at least one other table.
+        */
+        int shared = 0;
+        for (Page* page : pages) {
+            if (page->refs.load() > 1) shared++;
+        }
+        return shared;
+    }
+
+    static PageArena& arena() {
+        // The arena shared by all tables for huge page backed pages.
+        static PageArena instance(sizeof(Page));
+        return instance;
+    }
+
+private:
+    static Page* newPage(const Page* from) {
+        // Creates an empty page, or a copy of `from`, in the arena or on the heap as configured.
+        if (!huge_pages) return from ? new Page(*from) : new Page();
+        void* memory = arena().allocate();
+        Page* page = from ? new (memory) Page(*from) : new (memory) Page();
+        page->arena_backed = true;
+        return page;
+    }
+
+    static void release(Page* page) {
+        // Whoever drops the last reference frees the page, back to wherever it came from.
+        // Each page remembers its origin, so the option can change while older tables are alive.
+        if (page->refs.fetch_sub(1) != 1) return;
+        if (page->arena_backed) {
+            page->~Page();
+            arena().deallocate(page);
+        } else {
+            delete page;
+        }
+    }
+};
+
+bool ProcessTable::huge_pages = false;
+
 class Scheduler {
     // the scheduler algorithm based on circular linked list.
 public:
@@ -53,15 +517,32 @@ public:
     int total;      // Total number of processes in the scheduler
     int rem;        // Remaining number of processes in the scheduler
     int cycles;     // Number of cycles, the scheduler has gone through
-    Process* tail;  // pointer to last node
+    long long slices;      // Number of time slices handed out so far
+    long long turnaround;  // Sum of (completion cycle - arrival cycle) over completed processes
+    bool verbose;   // Whether cycle() prints its working to cout
+    ProcessTable table;  // Storage for the processes, linked through their table indices
+    int tail;       // table index of last node (-1 if empty)
 
-    Scheduler(int Cpu_time) {
+    Scheduler(int Cpu_time, bool Verbose = true) {
         // Constructor to initialize all variables.
         cpu_time = Cpu_time;
         total = 0;
         rem = 0;
         cycles = 0;
-        tail = nullptr;
+        slices = 0;
+        turnaround = 0;
+        verbose = Verbose;
+        tail = -1;
+    }
+
+    Scheduler fork() const {
+        /*
+        Desc: Creates an independent copy of the scheduler for what-if exploration. The copy shares
+                the process table copy-on-write, so it only pays for the pages it later changes.
+        returns:
+        (Scheduler): the forked scheduler.
+        */
+        return *this;
     }
 
     void addProcess(int exec_time) {
@@ -74,14 +555,14 @@ public:
         total += 1;
         rem += 1;
         string id = 'P' + to_string(total);
-        Process* new_node = new Process(id, exec_time);
-        if (tail == nullptr) {
+        int new_node = table.add(Process(id, exec_time, cycles));
+        if (tail == -1) {
             tail = new_node;
-            tail->next = tail;  // Circular link (points to itself)
+            table.at(tail).next = tail;  // Circular link (points to itself)
         } else {
-            new_node->next = tail->next;  // Insert after tail (at head)
-            tail->next = new_node;        // Point tail to new node
-            tail = new_node;              // Update tail
+            table.at(new_node).next = table.get(tail).next;  // Insert after tail (at head)
+            table.at(tail).next = new_node;                  // Point tail to new node
+            tail = new_node;                                 // Update tail
         }
     }
 
@@ -92,34 +573,22 @@ public:
             id (string): id for process to be deleted.
         */
 
-        if (tail == nullptr) return;  // No process to delete
+        if (tail == -1) return;  // No process to delete
 
-        Process* current = tail->next;  // Start from head
-        Process* prev = tail;
+        int current = table.get(tail).next;  // Start from head
+        int prev = tail;
 
         // Traverse the list to find the process to delete
         do {
-            if (current->id == id) {
-                rem -= 1;
-                if (current == tail && current == tail->next) {
-                    // If the list has only one process
-                    tail = nullptr;
-                } else if (current == tail) {
-                    // If we're deleting the tail
-                    prev->next = tail->next;  // Bypass tail
-                    tail = prev;              // Move tail back
-                } else {
-                    // Deleting a non-tail process
-                    prev->next = current->next;
-                }
-                delete current;  // Free memory
+            if (table.get(current).id == id) {
+                unlink(prev, current);
                 return;
             }
             else {
                 prev = current;
-                current = current->next;
+                current = table.get(current).next;
             }
-        } while (current != tail->next);  // Stop when we've circled back to the head
+        } while (current != table.get(tail).next);  // Stop when we've circled back to the head
     }
 
     void cycle() {
@@ -127,41 +596,454 @@ public:
         Desc: traverses the circular linked, calls the process function for each Process, outputs current working.
         */
 
-        if (tail == nullptr) {
+        if (tail == -1) {
             // List's empty
-            cout << "All processes completed!" << endl;
+            if (verbose) cout << "All processes completed!" << endl;
             return;
         }
 
+        PROFILE_PHASE(PHASE_ROUND);
+
         // Increments cycle count.
         cycles += 1;
-        cout << "Cycle " << cycles << ": ";
+        if (verbose) cout << "Cycle " << cycles << ": ";
 
-        // Traversing.
-        Process* current = tail->next;  // Start from head
-        Process* start = current;       // To mark the head of the list
+        // Traversing, once over each process present at the start of the cycle.
+        int prev = tail;
+        int current = table.get(tail).next;  // Start from head
+        for (int count = rem; count > 0; count--) {
+            PROFILE_PHASE(PHASE_PICK);
+            Process& p = table.at(current);
+            if (verbose) cout << p.id << " ";
+            p.process(cpu_time);  // Process for CPU time slice
+            slices += 1;
 
-        do {
-            cout << current->id << " ";
-            current->process(cpu_time);  // Process for CPU time slice
-
-            if (current->has_ended()) {
-                cout << "(Completes), ";
-                Process* to_delete = current;
-                current = current->next;  // Move to the next process before deleting
-                delProcess(to_delete->id);
-                if (tail == nullptr) break;  // If the last process was deleted, exit
+            if (p.has_ended()) {
+                if (verbose) cout << "(Completes), ";
+                turnaround += cycles - p.arrival;
+                int next = p.next;  // Move to the next process before deleting
+                unlink(prev, current);
+                current = next;
             } else {
-                cout << "(Remaining: " << current->rem_time << "), ";
-                current = current->next;
+                if (verbose) cout << "(Remaining: " << p.rem_time << "), ";
+                prev = current;
+                current = p.next;
             }
-        } while (current != start && tail != nullptr);  // Ensure a full cycle around the list
+        }
+
+        if (verbose) cout << endl;
+    }
+
+private:
+    void unlink(int prev, int current) {
+        /*
+        Desc: Removes a process from the circular list, given the process linked before it.
+        Parameters:
+            prev (int): table index of the process before the one being removed.
+            current (int): table index of the process being removed.
+        */
+        rem -= 1;
+        if (current == tail && current == table.get(tail).next) {
+            // If the list has only one process
+            tail = -1;
+        } else if (current == tail) {
+            // If we're deleting the tail
+            table.at(prev).next = table.get(tail).next;  // Bypass tail
+            tail = prev;                                 // Move tail back
+        } else {
+            // Deleting a non-tail process
+            table.at(prev).next = table.get(current).next;
+        }
+        // The slot itself stays in the table; pages are only freed with the table.
+    }
+};
+
+void tlbBenchmark(int processes, int cycles) {
+    /*
+    Desc: Cycles a scheduler holding many processes with the process table on normal pages and
+            then on huge pages, reporting time and dTLB load misses for each.
+    Parameters:
+        processes (int): number of processes placed in the scheduler.
+        cycles (int): number of full cycles to time.
+    */
+    cout << left << setw(14) << "Table pages" << right << setw(12) << "Time (ms)" << setw(18)
+         << "dTLB misses" << endl;
+    for (bool huge : {false, true}) {
+        ProcessTable::huge_pages = huge;
+        Scheduler sc(1, false);
+        for (int i = 0; i < processes; i++) sc.addProcess(cycles + 1);  // Nobody completes in time
 
+#ifdef __linux__
+        PerfCounter misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                               (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+        PerfCounter misses(0, 0);
+#endif
+        auto start = chrono::steady_clock::now();
+        misses.start();
+        for (int c = 0; c < cycles; c++) sc.cycle();
+        long long count = misses.stop();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << left << setw(14) << (huge ? "huge (2 MB)" : "normal") << right << setw(12) << fixed
+             << setprecision(1) << secs * 1000 << setw(18);
+        if (count >= 0) cout << count; else cout << "n/a";
         cout << endl;
     }
+    ProcessTable::huge_pages = false;
+
+    PageArena& arena = ProcessTable::arena();
+    cout << "Huge page regions: " << arena.hugetlb_regions << " MAP_HUGETLB, " << arena.thp_regions
+         << " transparent, " << arena.heap_regions << " heap fallback" << endl;
+}
+
+struct alignas(64) Core {
+    // One simulated core with its own queue and counters. The alignment keeps every core on
+    // its own cache lines, so threads driving different cores never write to a shared line.
+    Scheduler sched;  // This core's round-robin queue
+
+    Core(int cpu_time) : sched(cpu_time, false) {}
+};
+
+class MultiCoreScheduler {
+    // Several cores, each running its own scheduler. Global statistics are never kept up to date
+    // by the cores; they are summed over the cores only when read.
+public:
+    vector<Core> cores;  // Per-core state, one cache-line aligned block each
+    int next_core;       // Core that receives the next new process
+
+    MultiCoreScheduler(int num_cores, int cpu_time) {
+        // Constructor creating the cores with the same time slice.
+        cores.reserve(num_cores);
+        for (int i = 0; i < num_cores; i++) cores.emplace_back(cpu_time);
+        next_core = 0;
+    }
+
+    void addProcess(int exec_time) {
+        /*
+        Desc: Places a new process on the cores in turn.
+        Parameters:
+            exec_time (int): execution time required for the process.
+        */
+        cores[next_core].sched.addProcess(exec_time);
+        next_core = (next_core + 1) % cores.size();
+    }
+
+    void runCore(int index) {
+        /*
+        Desc: Cycles one core until its queue is empty. Safe to call for different cores concurrently.
+        Parameters:
+            index (int): core to run.
+        */
+        Scheduler& sc = cores[index].sched;
+        while (sc.tail != -1) sc.cycle();
+    }
+
+    int total() const {
+        // Total number of processes over all cores.
+        int sum = 0;
+        for (const Core& core : cores) sum += core.sched.total;
+        return sum;
+    }
+
+    int rem() const {
+        // Remaining number of processes over all cores.
+        int sum = 0;
+        for (const Core& core : cores) sum += core.sched.rem;
+        return sum;
+    }
+
+    long long slices() const {
+        // Number of time slices handed out over all cores.
+        long long sum = 0;
+        for (const Core& core : cores) sum += core.sched.slices;
+        return sum;
+    }
+
+    int cycles() const {
+        // Cycles of the busiest core, i.e. the length of the schedule.
+        int most = 0;
+        for (const Core& core : cores) most = max(most, core.sched.cycles);
+        return most;
+    }
+};
+
+void scalingBenchmark(int per_core, int exec_time) {
+    /*
+    Desc: Measures slice throughput with 1 to 64 threads, each driving its own core.
+            Every core gets the same load, so ideal scaling is linear in the number of threads.
+    Parameters:
+        per_core (int): number of processes placed on each core.
+        exec_time (int): execution time of every process (the time slice is 1).
+    */
+    cout << right << setw(8) << "Threads" << setw(14) << "Slices" << setw(12) << "Time (ms)"
+         << setw(18) << "Slices/sec" << setw(10) << "Speedup" << endl;
+    double base_rate = 0;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        MultiCoreScheduler mc(threads, 1);
+        for (int i = 0; i < threads * per_core; i++) mc.addProcess(exec_time);
+
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++) workers.emplace_back(&MultiCoreScheduler::runCore, &mc, t);
+        for (thread& th : workers) th.join();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        double rate = mc.slices() / secs;
+        if (threads == 1) base_rate = rate;
+        cout << setw(8) << threads << setw(14) << mc.slices() << setw(12) << fixed << setprecision(1)
+             << secs * 1000 << setw(18) << setprecision(0) << rate << setw(10) << setprecision(2)
+             << rate / base_rate << endl;
+    }
+}
+
+struct Arrival {
+    // A process arriving once the scheduler has completed `after_cycle` cycles.
+    int after_cycle;  // Cycle count after which the process arrives
+    int exec_time;    // Total execution time of the arriving process
+};
+
+class Workload {
+    // A decoded list of arrivals, sorted by arrival cycle, shared read-only between schedulers.
+public:
+    vector<Arrival> arrivals;
+
+    static Workload demo() {
+        /*
+        Desc: The workload used by the single-scheduler demo in main().
+        returns:
+        (Workload): P1-P3 arriving at the start, P4 arriving after the second cycle.
+        */
+        Workload w;
+        w.arrivals = {{0, 10}, {0, 5}, {0, 8}, {2, 6}};
+        return w;
+    }
+
+    static Workload parse(istream& in) {
+        /*
+        Desc: Decodes a workload given as whitespace separated "after_cycle exec_time" pairs.
+        Parameters:
+            in (istream&): stream to read the pairs from.
+        returns:
+        (Workload): the decoded arrivals, stably sorted by arrival cycle.
+        */
+        Workload w;
+        Arrival a;
+        while (in >> a.after_cycle >> a.exec_time) {
+            w.arrivals.push_back(a);
+        }
+        stable_sort(w.arrivals.begin(), w.arrivals.end(),
+                    [](const Arrival& x, const Arrival& y) { return x.after_cycle < y.after_cycle; });
+        return w;
+    }
 };
 
-int main() {
+size_t deliverArrivals(Scheduler& sc, const Workload& workload, size_t next) {
+    /*
+    Desc: Adds the processes that are due to a scheduler. If the scheduler has run dry, its clock
+            skips ahead over the idle time to the next arrival, and every process due by then
+            arrives together.
+    Parameters:
+        sc (Scheduler&): scheduler receiving the arrivals.
+        workload (const Workload&): the arrivals being replayed.
+        next (size_t): index of the first arrival not yet delivered.
+    returns:
+    (size_t): index of the first arrival still not delivered.
+    */
+    const vector<Arrival>& arrivals = workload.arrivals;
+    if (sc.tail == -1 && next < arrivals.size()) sc.cycles = max(sc.cycles, arrivals[next].after_cycle);
+    while (next < arrivals.size() && arrivals[next].after_cycle <= sc.cycles) {
+        sc.addProcess(arrivals[next].exec_time);
+        next++;
+    }
+    return next;
+}
+
+void printReport(const vector<string>& names, const vector<Scheduler>& schedulers) {
+    /*
+    Desc: Prints one merged table with a row of statistics per scheduler.
+    Parameters:
+        names (const vector<string>&): label of each row.
+        schedulers (const vector<Scheduler>&): drained schedulers to report on.
+    */
+    cout << left << setw(16) << "Policy" << right << setw(10) << "Cycles" << setw(10) << "Slices"
+         << setw(18) << "Avg turnaround" << endl;
+    for (size_t t = 0; t < schedulers.size(); t++) {
+        const Scheduler& sc = schedulers[t];
+        double avg = sc.total ? (double)sc.turnaround / sc.total : 0.0;
+        cout << left << setw(16) << names[t] << right << setw(10) << sc.cycles
+             << setw(10) << sc.slices << setw(18) << fixed << setprecision(2) << avg << endl;
+    }
+}
+
+void compareQuanta(const Workload& workload, const vector<int>& quanta) {
+    /*
+    Desc: Runs one round-robin scheduler per quantum over the same decoded workload.
+            Each scheduler runs on its own thread, and all of them advance one cycle at a time
+            in lockstep. A single merged report is printed once every scheduler has drained.
+    Parameters:
+        workload (const Workload&): arrivals shared by all schedulers.
+        quanta (const vector<int>&): CPU time slice of each scheduler being compared.
+    */
+    size_t n = quanta.size();
+    vector<Scheduler> schedulers;
+    schedulers.reserve(n);
+    for (int q : quanta) schedulers.emplace_back(q, false);
+
+    barrier<> sync(n);  // Every scheduler finishes cycle c before any starts cycle c + 1
+    vector<thread> threads;
+    for (size_t t = 0; t < n; t++) {
+        threads.emplace_back([&, t]() {
+            Scheduler& sc = schedulers[t];
+            size_t next = 0;  // Index of the next arrival to deliver
+            while (true) {
+                next = deliverArrivals(sc, workload, next);
+                if (sc.tail == -1) break;  // Drained with nothing left to arrive
+                sc.cycle();
+                sync.arrive_and_wait();
+            }
+            sync.arrive_and_drop();  // Stop holding up the schedulers still running
+        });
+    }
+    for (thread& th : threads) th.join();
+
+    vector<string> names;
+    for (int q : quanta) names.push_back("RR(q=" + to_string(q) + ")");
+    printReport(names, schedulers);
+}
+
+void whatIf(const Workload& workload, int fork_cycle, int exec_time, const vector<int>& quanta) {
+    /*
+    Desc: Warms up one scheduler on the workload until `fork_cycle` cycles have run, then forks it
+            once per quantum. In every fork an extra process arrives and the rest of the workload
+            is replayed under that fork's quantum.
+    Parameters:
+        workload (const Workload&): arrivals replayed by the warm-up and by every fork.
+        fork_cycle (int): cycle count at which the schedulers are forked.
+        exec_time (int): execution time of the extra process arriving in each fork.
+        quanta (const vector<int>&): CPU time slice of each fork; the first one is used for the warm-up.
+    */
+    Scheduler base(quanta[0], false);
+    size_t next = 0;
+    while (base.cycles < fork_cycle) {
+        next = deliverArrivals(base, workload, next);
+        if (base.tail == -1) break;
+        base.cycle();
+    }
+
+    vector<Scheduler> forks;
+    for (int q : quanta) {
+        Scheduler sc = base.fork();
+        sc.cpu_time = q;
+        sc.addProcess(exec_time);
+        size_t pending = next;
+        while (true) {
+            pending = deliverArrivals(sc, workload, pending);
+            if (sc.tail == -1) break;
+            sc.cycle();
+        }
+        forks.push_back(move(sc));
+    }
+
+    cout << "Forked after cycle " << base.cycles << " with " << base.table.pages.size()
+         << " table page(s); each fork adds a process of " << exec_time << "." << endl;
+    vector<string> names;
+    for (size_t t = 0; t < quanta.size(); t++) {
+        names.push_back("RR(q=" + to_string(quanta[t]) + ")");
+    }
+    printReport(names, forks);
+}
+
+bool parseInt(const string& text, int& value) {
+    /*
+    Desc: Parses a command line argument that must be a whole decimal int.
+    Parameters:
+        text (const string&): the argument.
+        value (int&): receives the number.
+    returns:
+    (bool): false if the argument is not a number, has trailing characters or overflows an int.
+    */
+    try {
+        size_t used;
+        value = stoi(text, &used);
+        return used == text.size();
+    } catch (const logic_error&) {
+        return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Comparison mode: p1 --compare <quantum>... [--workload <file>]
+    // What-if mode:    p1 --whatif <fork_cycle> <exec_time> <quantum>... [--workload <file>]
+    // Scaling mode:    p1 --scale [processes_per_core] [exec_time]
+    // TLB mode:        p1 --tlb [processes] [cycles]
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--tlb") {
+        int processes = argc > 2 ? stoi(argv[2]) : 2000000;
+        int cycles = argc > 3 ? stoi(argv[3]) : 5;
+        tlbBenchmark(processes, cycles);
+        return 0;
+    }
+    if (mode == "--scale") {
+        int per_core = argc > 2 ? stoi(argv[2]) : 1000;
+        int exec_time = argc > 3 ? stoi(argv[3]) : 200;
+        scalingBenchmark(per_core, exec_time);
+        return 0;
+    }
+    if (mode == "--compare" || mode == "--whatif") {
+        auto usage = [] {
+            cout << "Usage: p1 --compare <quantum>... [--workload <file>]" << endl;
+            cout << "       p1 --whatif <fork_cycle> <exec_time> <quantum>... [--workload <file>]" << endl;
+            return 1;
+        };
+        vector<int> quanta;
+        Workload workload = Workload::demo();
+        for (int i = 2; i < argc; i++) {
+            string arg = argv[i];
+            int value;
+            if (arg == "--workload") {
+                if (i + 1 == argc) return usage();
+                ifstream file(argv[++i]);
+                if (!file) {
+                    cout << "Could not open workload file: " << argv[i] << endl;
+                    return 1;
+                }
+                workload = Workload::parse(file);
+            } else if (parseInt(arg, value)) {
+                quanta.push_back(value);
+            } else {
+                cout << "Not a number: " << arg << endl;
+                return usage();
+            }
+        }
+        auto positive = [](const vector<int>& slices) {
+            // A slice of 0 or less never drains a process, so the scheduler would spin forever
+            for (int q : slices) {
+                if (q <= 0) {
+                    cout << "Quantum must be positive: " << q << endl;
+                    return false;
+                }
+            }
+            return true;
+        };
+        if (mode == "--compare" && !quanta.empty()) {
+            if (!positive(quanta)) return usage();
+            compareQuanta(workload, quanta);
+        } else if (mode == "--whatif" && quanta.size() > 2) {
+            vector<int> fork_quanta(quanta.begin() + 2, quanta.end());
+            if (quanta[0] < 0 || quanta[1] < 0) {
+                cout << "Fork cycle and execution time must not be negative" << endl;
+                return usage();
+            }
+            if (!positive(fork_quanta)) return usage();
+            whatIf(workload, quanta[0], quanta[1], fork_quanta);
+        } else {
+            return usage();
+        }
+        return 0;
+    }
+
     Scheduler sc(3);
 
     sc.addProcess(10);
@@ -171,7 +1053,7 @@ int main() {
     cout << "Initial Processes: [(P1, 10), (P2, 5), (P3, 8)]" << endl;
 
     int i = 0;
-    while (sc.tail != nullptr) {  // Continue cycling until all processes are completed
+    while (sc.tail != -1) {  // Continue cycling until all processes are completed
         sc.cycle();
         if (i == 1) {
             // Adding a new process at a random point.
@@ -2,205 +2,4290 @@
 Author(s): 1. Hanzala B. Rehan
 Description: Checking a 309 digit if it's prime or not, using Rabin-Miller Algorithm.
 Date created: October 5th, 2024.
-Date last modified: October 5th, 2024.
+Date last modified: October 16th, 2026.
 */
 #include <iostream>
 #include <string>
 #include <vector>
 #include <random>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <array>
+#include <span>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <optional>
+#include <filesystem>
+#include <memory>
+#include <new>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
-// Node class to represent each chunk of the large number
-class Node {
+// Per-thread bump-pointer allocator for limb temporaries that die with the call that made them
+// (Karatsuba sums, unreduced products, window tables). A Frame records the top on entry and
+// pops everything above it on exit. Blocks are kept once allocated, so after the first few
+// operations of a given size nothing reaches the heap.
+class ScratchArena {
 public:
-    uint64_t value; // 64-bit chunk value (up to 19 digits)
-    Node* next; // Pointer to the next node
+    static const size_t MIN_BLOCK_LIMBS = 1 << 14; // 128 KB
 
-    // Constructor to initialize a node with a value
-    Node(uint64_t val) {
-        value = val;
-        next = nullptr;
+    static ScratchArena& local() {
+        thread_local ScratchArena arena;
+        return arena;
     }
+
+    uint64_t* alloc(size_t n) {
+        /*
+        Desc: Reserves n uninitialized limbs, aligned to 64 bytes, until the enclosing Frame ends.
+        */
+        n = (n + 7) & ~size_t(7);
+        if (current == blocks.size() || top + n > blocks[current].size) {
+            // Move on to the next block, inserting a fresh one if it is missing or too small
+            size_t next = current == blocks.size() ? current : current + 1;
+            if (next == blocks.size() || blocks[next].size < n) {
+                size_t size = max(n, blocks.empty() ? MIN_BLOCK_LIMBS : 2 * blocks.back().size);
+                Block block{unique_ptr<uint64_t[]>(new uint64_t[size + 7]), nullptr, size};
+                block.data = (uint64_t*)(((uintptr_t)block.storage.get() + 63) & ~uintptr_t(63));
+                blocks.insert(blocks.begin() + next, move(block));
+            }
+            current = next;
+            top = 0;
+        }
+        uint64_t* out = blocks[current].data + top;
+        top += n;
+        return out;
+    }
+
+    class Frame {
+    public:
+        Frame() : arena(local()), current(arena.current), top(arena.top) {}
+        ~Frame() {
+            arena.current = current;
+            arena.top = top;
+        }
+        uint64_t* alloc(size_t n) { return arena.alloc(n); }
+
+    private:
+        ScratchArena& arena;
+        size_t current, top; // The arena's position on entry
+    };
+
+private:
+    struct Block {
+        unique_ptr<uint64_t[]> storage;
+        uint64_t* data; // storage rounded up to 64 bytes
+        size_t size;    // Usable limbs
+    };
+    vector<Block> blocks;
+    size_t current = 0; // Block being bumped; blocks.size() before the first allocation
+    size_t top = 0;     // Limbs used in the current block
 };
 
-// LargeNumber class to handle large numbers using a linked list
-class LargeNumber {
+// Small-buffer-optimized vector of 64-bit limbs. Numbers of up to INLINE_LIMBS limbs
+// (2048 bits) live inside the object; larger ones move to the heap, in power-of-two blocks
+// that a per-thread cache recycles, so the same sizes coming and going stop allocating.
+class LimbVector {
 public:
-    Node* head; // Head pointer to the first node
+    static const size_t INLINE_LIMBS = 32;
 
-    // Constructor to initialize an empty LargeNumber
-    LargeNumber() {
-        head = nullptr;
+    LimbVector() {
+        ptr = buf;
+        len = 0;
+        cap = INLINE_LIMBS;
+    }
+
+    LimbVector(const LimbVector& other) : LimbVector() {
+        assign(other.ptr, other.len);
+    }
+
+    LimbVector(LimbVector&& other) noexcept : LimbVector() {
+        steal(other);
+    }
+
+    LimbVector& operator=(const LimbVector& other) {
+        if (this != &other) assign(other.ptr, other.len);
+        return *this;
     }
 
-    // Destructor to free memory of the linked list
-    ~LargeNumber() {
-        Node* current = head;
-        while (current != nullptr) {
-            Node* temp = current;
-            current = current->next;
-            delete temp; // Free each node
+    LimbVector& operator=(LimbVector&& other) noexcept {
+        if (this != &other) {
+            if (ptr != buf) releaseBlock(ptr, cap);
+            ptr = buf;
+            cap = INLINE_LIMBS;
+            steal(other);
         }
+        return *this;
     }
 
-    // Add a chunk (19-digit piece) to the LargeNumber
-    void addChunk(uint64_t chunk) {
-        Node* newNode = new Node(chunk); // Create a new node
-        if (head == nullptr) {
-            head = newNode; // If empty, set head to new node
-        } else {
-            Node* current = head;
-            while (current->next != nullptr) {
-                current = current->next; // Traverse to the last node
+    ~LimbVector() {
+        if (ptr != buf) releaseBlock(ptr, cap);
+    }
+
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    uint64_t* data() { return ptr; }
+    const uint64_t* data() const { return ptr; }
+    uint64_t& operator[](size_t i) { return ptr[i]; }
+    uint64_t operator[](size_t i) const { return ptr[i]; }
+    uint64_t back() const { return ptr[len - 1]; }
+    void pop_back() { len--; }
+    void clear() { len = 0; }
+
+    void push_back(uint64_t limb) {
+        if (len == cap) reserve(cap * 2);
+        ptr[len++] = limb;
+    }
+
+    void reserve(size_t n) {
+        // Grows the storage to hold at least n limbs, keeping the current ones.
+        if (n <= cap) return;
+        size_t new_cap = max(n, cap * 2);
+        uint64_t* grown = allocateBlock(new_cap);
+        memcpy(grown, ptr, len * sizeof(uint64_t));
+        if (ptr != buf) releaseBlock(ptr, cap);
+        ptr = grown;
+        cap = new_cap;
+    }
+
+    void resize(size_t n) {
+        // Changes the number of limbs; new limbs are zero.
+        reserve(n);
+        if (n > len) memset(ptr + len, 0, (n - len) * sizeof(uint64_t));
+        len = n;
+    }
+
+    void assign(const uint64_t* src, size_t n) {
+        reserve(n);
+        memcpy(ptr, src, n * sizeof(uint64_t));
+        len = n;
+    }
+
+private:
+    uint64_t* ptr;                  // Inline buffer or heap storage
+    size_t len;                     // Number of limbs in use
+    size_t cap;                     // Number of limbs available
+    uint64_t buf[INLINE_LIMBS];     // Inline storage for small numbers
+
+    // Free blocks of 2^i limbs, linked through their first limb. Plain data, so it outlives the
+    // thread's destructors; `closed` is set once the thread has drained it on exit.
+    struct BlockCache {
+        uint64_t* free[64];
+        uint8_t count[64];
+        bool closed;
+    };
+    static const size_t CACHED_LIMBS = 1 << 16; // Per size: up to 64 blocks, at least 2
+
+    static BlockCache& cache() {
+        thread_local BlockCache blocks{};
+        thread_local struct Drain {
+            ~Drain() {
+                BlockCache& c = blocks;
+                for (int i = 0; i < 64; i++) {
+                    while (c.free[i]) {
+                        uint64_t* next = (uint64_t*)c.free[i][0];
+                        delete[] c.free[i];
+                        c.free[i] = next;
+                    }
+                }
+                c.closed = true;
             }
-            current->next = newNode; // Add new node at the end
+        } drain;
+        (void)drain;
+        return blocks;
+    }
+
+    static uint64_t* allocateBlock(size_t& n) {
+        // A block of at least n limbs; n is rounded up to the block's size.
+        int i = 64 - __builtin_clzll(n - 1);
+        n = size_t(1) << i;
+        BlockCache& c = cache();
+        if (uint64_t* block = c.free[i]) {
+            c.free[i] = (uint64_t*)block[0];
+            c.count[i]--;
+            return block;
         }
+        return new uint64_t[n];
     }
 
-    // Print the LargeNumber (from most significant to least)
-    void print() const {
-        printRecursive(head);
+    static void releaseBlock(uint64_t* block, size_t n) {
+        int i = __builtin_ctzll(n);
+        BlockCache& c = cache();
+        if (c.closed || c.count[i] >= min<size_t>(64, max<size_t>(2, CACHED_LIMBS >> i))) {
+            delete[] block;
+            return;
+        }
+        block[0] = (uint64_t)c.free[i];
+        c.free[i] = block;
+        c.count[i]++;
     }
 
-    // Implementation of the Miller-Rabin primality test
-    bool millerRabin(int k) const {
+    void steal(LimbVector& other) {
+        // Takes over the other vector's heap storage, or copies its inline limbs.
+        if (other.ptr == other.buf) {
+            assign(other.buf, other.len);
+        } else {
+            ptr = other.ptr;
+            cap = other.cap;
+            len = other.len;
+            other.ptr = other.buf;
+            other.cap = INLINE_LIMBS;
+        }
+        other.len = 0;
+    }
+};
+
+// Arbitrary-precision unsigned integer stored as base 2^64 limbs, least significant first.
+class BigInt {
+public:
+    LimbVector limbs; // Limbs without leading zeros; zero has no limbs
+
+    BigInt() {}
+
+    BigInt(uint64_t value) {
+        if (value != 0) limbs.push_back(value);
+    }
+
+    bool isZero() const { return limbs.empty(); }
+    bool isOdd() const { return !limbs.empty() && (limbs[0] & 1); }
+    uint64_t low() const { return limbs.empty() ? 0 : limbs[0]; } // Least significant 64 bits
+
+    size_t bitLength() const {
+        // Number of bits needed to write the number (0 for zero).
+        if (limbs.empty()) return 0;
+        return limbs.size() * 64 - __builtin_clzll(limbs.back());
+    }
+
+    bool bit(size_t i) const {
+        // Value of bit i, counting from the least significant bit.
+        return i / 64 < limbs.size() && ((limbs[i / 64] >> (i % 64)) & 1);
+    }
+
+    void normalize() {
+        // Drops leading zero limbs.
+        while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    }
+
+    static int compare(const BigInt& a, const BigInt& b) {
         /*
-        Desc: Performs the Miller-Rabin primality test on the number stored in the linked list.
-        Parameters:
-            k (int): Number of iterations to perform for accuracy.
+        Desc: Three-way comparison of two numbers.
         Returns:
-            bool: True if the number is probably prime, False if composite.
+            int: -1 if a < b, 0 if a == b, 1 if a > b.
+        */
+        if (a.limbs.size() != b.limbs.size()) return a.limbs.size() < b.limbs.size() ? -1 : 1;
+        for (size_t i = a.limbs.size(); i-- > 0;) {
+            if (a.limbs[i] != b.limbs[i]) return a.limbs[i] < b.limbs[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    friend bool operator==(const BigInt& a, const BigInt& b) { return compare(a, b) == 0; }
+    friend bool operator!=(const BigInt& a, const BigInt& b) { return compare(a, b) != 0; }
+    friend bool operator<(const BigInt& a, const BigInt& b) { return compare(a, b) < 0; }
+    friend bool operator<=(const BigInt& a, const BigInt& b) { return compare(a, b) <= 0; }
+    friend bool operator>(const BigInt& a, const BigInt& b) { return compare(a, b) > 0; }
+    friend bool operator>=(const BigInt& a, const BigInt& b) { return compare(a, b) >= 0; }
+
+    BigInt& operator+=(const BigInt& b) {
+        size_t n = max(limbs.size(), b.limbs.size());
+        limbs.resize(n);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            unsigned __int128 sum = (unsigned __int128)limbs[i] + (i < b.limbs.size() ? b.limbs[i] : 0) + carry;
+            limbs[i] = (uint64_t)sum;
+            carry = (uint64_t)(sum >> 64);
+        }
+        if (carry) limbs.push_back(carry);
+        return *this;
+    }
+
+    BigInt& operator-=(const BigInt& b) {
+        // Subtraction of unsigned numbers; requires *this >= b.
+        if (*this < b) throw domain_error("BigInt subtraction would be negative");
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < limbs.size(); i++) {
+            uint64_t sub = i < b.limbs.size() ? b.limbs[i] : 0;
+            if (sub == 0 && borrow == 0 && i >= b.limbs.size()) break;
+            uint64_t diff = limbs[i] - sub;
+            uint64_t next_borrow = limbs[i] < sub;
+            next_borrow += diff < borrow;
+            limbs[i] = diff - borrow;
+            borrow = next_borrow;
+        }
+        normalize();
+        return *this;
+    }
+
+    BigInt& operator*=(const BigInt& b) {
+        *this = *this * b;
+        return *this;
+    }
+
+    friend BigInt operator+(BigInt a, const BigInt& b) { return a += b; }
+    friend BigInt operator-(BigInt a, const BigInt& b) { return a -= b; }
+
+    friend BigInt operator*(const BigInt& a, const BigInt& b) {
+        // Multiplication, picking schoolbook, Karatsuba or Toom-3 by operand size.
+        BigInt result;
+        if (a.isZero() || b.isZero()) return result;
+        result.limbs.resize(a.limbs.size() + b.limbs.size());
+        if (a.limbs.size() >= b.limbs.size()) {
+            mulLimbs(result.limbs.data(), a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size());
+        } else {
+            mulLimbs(result.limbs.data(), b.limbs.data(), b.limbs.size(), a.limbs.data(), a.limbs.size());
+        }
+        result.normalize();
+        return result;
+    }
+
+    static BigInt square(const BigInt& a) {
+        // Squaring, with its own schoolbook, Karatsuba and Toom-3 paths.
+        BigInt result;
+        if (a.isZero()) return result;
+        result.limbs.resize(2 * a.limbs.size());
+        sqrLimbs(result.limbs.data(), a.limbs.data(), a.limbs.size());
+        result.normalize();
+        return result;
+    }
+
+    // Crossover points, in limbs, between the multiplication algorithms. Tuned on the build
+    // host with `p2 --tune`; below the Karatsuba threshold schoolbook is used.
+    static const size_t KARATSUBA_MUL_THRESHOLD = 32;
+    static const size_t KARATSUBA_SQR_THRESHOLD = 48;
+    static const size_t TOOM3_MUL_THRESHOLD = 384;
+    static const size_t TOOM3_SQR_THRESHOLD = 512;
+
+    static void mulLimbs(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        /*
+        Desc: Computes the an + bn limb product r = a * b, choosing the algorithm by size.
+        Parameters:
+            r (uint64_t*): an + bn limbs for the product; must not overlap a or b.
+            a (const uint64_t*), an (size_t): The longer operand, an >= bn.
+            b (const uint64_t*), bn (size_t): The shorter operand, bn >= 1.
+        */
+        if (bn < KARATSUBA_MUL_THRESHOLD) {
+            mulBasecase(r, a, an, b, bn);
+        } else if (an == bn) {
+            if (an >= TOOM3_MUL_THRESHOLD) mulToom3(r, a, b, an);
+            else mulKaratsuba(r, a, b, an);
+        } else {
+            // Unbalanced: multiply b by bn-limb slices of a and add the slices up.
+            memset(r, 0, (an + bn) * sizeof(uint64_t));
+            ScratchArena::Frame frame;
+            uint64_t* part = frame.alloc(2 * bn);
+            for (size_t pos = 0; pos < an; pos += bn) {
+                size_t len = min(bn, an - pos);
+                if (len == bn) mulLimbs(part, a + pos, len, b, bn);
+                else mulLimbs(part, b, bn, a + pos, len);
+                addInto(r + pos, an + bn - pos, part, len + bn);
+            }
+        }
+    }
+
+    static void sqrLimbs(uint64_t* r, const uint64_t* a, size_t n) {
+        /*
+        Desc: Computes the 2n limb square r = a * a, choosing the algorithm by size.
+        Parameters:
+            r (uint64_t*): 2n limbs for the square; must not overlap a.
+            a (const uint64_t*), n (size_t): The operand.
+        */
+        if (n < KARATSUBA_SQR_THRESHOLD) sqrBasecase(r, a, n);
+        else if (n >= TOOM3_SQR_THRESHOLD) sqrToom3(r, a, n);
+        else sqrKaratsuba(r, a, n);
+    }
+
+    static void mulBasecase(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        // Schoolbook multiplication, one row per limb of b.
+        memset(r, 0, (an + bn) * sizeof(uint64_t));
+        for (size_t i = 0; i < bn; i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < an; j++) {
+                unsigned __int128 t = (unsigned __int128)a[j] * b[i] + r[i + j] + carry;
+                r[i + j] = (uint64_t)t;
+                carry = (uint64_t)(t >> 64);
+            }
+            r[i + an] = carry;
+        }
+    }
+
+    static void sqrBasecase(uint64_t* r, const uint64_t* x, size_t n) {
+        // Schoolbook squaring: each cross product x[i] * x[j] is formed once and doubled,
+        // which needs about half the limb multiplies of a general product.
+        memset(r, 0, 2 * n * sizeof(uint64_t));
+        for (size_t i = 0; i < n; i++) {
+            // Cross products x[i] * x[j] for j > i
+            uint64_t carry = 0;
+            for (size_t j = i + 1; j < n; j++) {
+                unsigned __int128 t = (unsigned __int128)x[i] * x[j] + r[i + j] + carry;
+                r[i + j] = (uint64_t)t;
+                carry = (uint64_t)(t >> 64);
+            }
+            r[i + n] = carry;
+        }
+        uint64_t top = 0;
+        for (size_t i = 0; i < 2 * n; i++) {
+            // Double the cross products
+            uint64_t next = r[i] >> 63;
+            r[i] = (r[i] << 1) | top;
+            top = next;
+        }
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            // Add the squares x[i]^2 on the diagonal
+            unsigned __int128 sq = (unsigned __int128)x[i] * x[i];
+            unsigned __int128 lo = (unsigned __int128)r[2 * i] + (uint64_t)sq + carry;
+            r[2 * i] = (uint64_t)lo;
+            unsigned __int128 hi = (unsigned __int128)r[2 * i + 1] + (uint64_t)(sq >> 64) + (uint64_t)(lo >> 64);
+            r[2 * i + 1] = (uint64_t)hi;
+            carry = (uint64_t)(hi >> 64);
+        }
+    }
+
+    static void mulKaratsuba(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+        /*
+        Desc: One level of Karatsuba for two n-limb operands: with a = a1*B^h + a0 and
+                b = b1*B^h + b0, the middle term is (a0+a1)(b0+b1) - a0*b0 - a1*b1,
+                so three half-size products replace four.
         */
-        if (head == nullptr) return false; // Return false if the number is empty
+        size_t h = (n + 1) / 2, l = n - h;
+        mulLimbs(r, a, h, b, h);                 // a0 * b0 in r[0, 2h)
+        mulLimbs(r + 2 * h, a + h, l, b + h, l); // a1 * b1 in r[2h, 2n)
+
+        ScratchArena::Frame frame;
+        uint64_t *sa = frame.alloc(h + 1), *sb = frame.alloc(h + 1), *mid = frame.alloc(2 * h + 2);
+        sa[h] = addLimbs(sa, a, h, a + h, l);
+        sb[h] = addLimbs(sb, b, h, b + h, l);
+        mulLimbs(mid, sa, h + 1, sb, h + 1);
+        subLimbs(mid, mid, 2 * h + 2, r, 2 * h);
+        subLimbs(mid, mid, 2 * h + 2, r + 2 * h, 2 * l);
+        addInto(r + h, 2 * n - h, mid, significant(mid, 2 * h + 2));
+    }
+
+    static void sqrKaratsuba(uint64_t* r, const uint64_t* a, size_t n) {
+        // One level of Karatsuba squaring: the middle term is (a0+a1)^2 - a0^2 - a1^2.
+        size_t h = (n + 1) / 2, l = n - h;
+        sqrLimbs(r, a, h);
+        sqrLimbs(r + 2 * h, a + h, l);
+
+        ScratchArena::Frame frame;
+        uint64_t *sa = frame.alloc(h + 1), *mid = frame.alloc(2 * h + 2);
+        sa[h] = addLimbs(sa, a, h, a + h, l);
+        sqrLimbs(mid, sa, h + 1);
+        subLimbs(mid, mid, 2 * h + 2, r, 2 * h);
+        subLimbs(mid, mid, 2 * h + 2, r + 2 * h, 2 * l);
+        addInto(r + h, 2 * n - h, mid, significant(mid, 2 * h + 2));
+    }
 
-        // Convert the linked list chunks into a single 64-bit integer (n)
-        Node* current = head;
-        uint64_t n = 0;
-        while (current != nullptr) {
-            n = n * 1000000000000000000ULL + current->value; // Combine chunks to form the number
-            current = current->next;
+    static void mulToom3(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+    static void sqrToom3(uint64_t* r, const uint64_t* a, size_t n);
+
+    static uint64_t addLimbs(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        // r = a + b over an limbs (an >= bn); returns the carry out. r may alias a.
+        uint64_t carry = 0;
+        for (size_t i = 0; i < an; i++) {
+            unsigned __int128 s = (unsigned __int128)a[i] + (i < bn ? b[i] : 0) + carry;
+            r[i] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
         }
+        return carry;
+    }
 
-        // Base cases for small numbers
-        if (n == 2 || n == 3) return true;  // 2 and 3 are prime numbers
-        if (n <= 1 || n % 2 == 0) return false;  // Exclude numbers <= 1 and even numbers
+    static uint64_t subLimbs(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        // r = a - b over an limbs (an >= bn); returns the borrow out. r may alias a.
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < an; i++) {
+            uint64_t sub = i < bn ? b[i] : 0;
+            uint64_t diff = a[i] - sub;
+            uint64_t next_borrow = a[i] < sub;
+            next_borrow += diff < borrow;
+            r[i] = diff - borrow;
+            borrow = next_borrow;
+        }
+        return borrow;
+    }
 
-        // Write n-1 as 2^s * d (factoring out powers of 2)
-        uint64_t d = n - 1;
-        int s = 0;
-        while (d % 2 == 0) {
-            d /= 2;  // Keep dividing by 2 to find d
-            s++;     // Count the powers of 2
+    static void addInto(uint64_t* r, size_t rn, const uint64_t* a, size_t an) {
+        // r += a, carrying as far as needed within rn limbs (an <= rn).
+        uint64_t carry = addLimbs(r, r, an, a, an);
+        for (size_t i = an; carry && i < rn; i++) {
+            r[i] += carry;
+            carry = r[i] == 0;
         }
+    }
 
-        // Random number generator setup
-        random_device rd;      // Seed for randomness
-        mt19937 gen(rd());     // Mersenne Twister RNG
-        uniform_int_distribution<uint64_t> dis(2, n - 2);  // Generate random base in [2, n-2]
+    static size_t significant(const uint64_t* a, size_t n) {
+        // Number of limbs once leading zeros are dropped.
+        while (n > 0 && a[n - 1] == 0) n--;
+        return n;
+    }
 
-        // Perform Miller-Rabin test for k iterations
-        for (int i = 0; i < k; i++) {
-            uint64_t a = dis(gen);  // Random base (a)
-            uint64_t x = power(a, d, n);  // Compute a^d % n
+    friend BigInt operator/(const BigInt& a, const BigInt& b) {
+        BigInt q, r;
+        divmod(a, b, q, r);
+        return q;
+    }
 
-            // If x == 1 or x == n-1, this round passes
-            if (x == 1 || x == n - 1) continue;
+    friend BigInt operator%(const BigInt& a, const BigInt& b) {
+        BigInt q, r;
+        divmod(a, b, q, r);
+        return r;
+    }
 
-            bool found = false;
-            // Perform up to s-1 squaring rounds (check for x^2, x^4, ..., until x == n-1)
-            for (int r = 1; r < s; r++) {
-                x = (x * x) % n;  // Compute x^2 % n
-                if (x == n - 1) {  // If x reaches n-1, the round passes
-                    found = true;
-                    break;
+    BigInt& operator<<=(size_t bits) {
+        if (isZero()) return *this;
+        size_t words = bits / 64;
+        unsigned shift = bits % 64;
+        size_t n = limbs.size();
+        limbs.resize(n + words + 1);
+        for (size_t i = n + words + 1; i-- > words;) {
+            uint64_t hi = i - words < n ? limbs[i - words] : 0;
+            uint64_t lo = (shift && i - words >= 1 && i - words - 1 < n) ? limbs[i - words - 1] : 0;
+            limbs[i] = shift ? (hi << shift) | (lo >> (64 - shift)) : hi;
+        }
+        for (size_t i = 0; i < words; i++) limbs[i] = 0;
+        normalize();
+        return *this;
+    }
+
+    BigInt& operator>>=(size_t bits) {
+        size_t words = bits / 64;
+        unsigned shift = bits % 64;
+        if (words >= limbs.size()) {
+            limbs.clear();
+            return *this;
+        }
+        size_t n = limbs.size() - words;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t lo = limbs[i + words];
+            uint64_t hi = i + words + 1 < limbs.size() ? limbs[i + words + 1] : 0;
+            limbs[i] = shift ? (lo >> shift) | (hi << (64 - shift)) : lo;
+        }
+        limbs.resize(n);
+        normalize();
+        return *this;
+    }
+
+    friend BigInt operator<<(BigInt a, size_t bits) { return a <<= bits; }
+    friend BigInt operator>>(BigInt a, size_t bits) { return a >>= bits; }
+
+    size_t trailingZeros() const {
+        // Number of trailing zero bits (0 for zero).
+        for (size_t i = 0; i < limbs.size(); i++) {
+            if (limbs[i] != 0) return i * 64 + __builtin_ctzll(limbs[i]);
+        }
+        return 0;
+    }
+
+    void mulSmall(uint64_t factor, uint64_t addend) {
+        // In place: *this = *this * factor + addend.
+        uint64_t carry = addend;
+        for (size_t i = 0; i < limbs.size(); i++) {
+            unsigned __int128 t = (unsigned __int128)limbs[i] * factor + carry;
+            limbs[i] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        if (carry) limbs.push_back(carry);
+        normalize();
+    }
+
+    uint64_t divSmall(uint64_t divisor) {
+        // In place: *this = *this / divisor. Returns the remainder.
+        unsigned __int128 rem = 0;
+        for (size_t i = limbs.size(); i-- > 0;) {
+            unsigned __int128 cur = (rem << 64) | limbs[i];
+            limbs[i] = (uint64_t)(cur / divisor);
+            rem = cur % divisor;
+        }
+        normalize();
+        return (uint64_t)rem;
+    }
+
+    static void divmod(const BigInt& a, const BigInt& b, BigInt& q, BigInt& r) {
+        /*
+        Desc: Long division of a by b (Knuth's Algorithm D with 64-bit digits).
+        Parameters:
+            a (const BigInt&): Dividend.
+            b (const BigInt&): Divisor, must not be zero.
+            q (BigInt&): Receives the quotient.
+            r (BigInt&): Receives the remainder.
+        */
+        if (b.isZero()) throw domain_error("BigInt division by zero");
+        if (a < b) {
+            r = a;
+            q = BigInt();
+            return;
+        }
+        if (b.limbs.size() == 1) {
+            q = a;
+            r = BigInt(q.divSmall(b.limbs[0]));
+            return;
+        }
+
+        // Normalize so the divisor's top bit is set, which keeps each quotient estimate off by at most 2.
+        size_t n = b.limbs.size();
+        size_t m = a.limbs.size() - n;
+        unsigned shift = __builtin_clzll(b.limbs.back());
+        BigInt v = b << shift;
+        BigInt u = a << shift;
+        u.limbs.resize(a.limbs.size() + 1);
+
+        BigInt quotient;
+        quotient.limbs.resize(m + 1);
+        uint64_t vtop = v.limbs[n - 1], vnext = v.limbs[n - 2];
+        for (size_t j = m + 1; j-- > 0;) {
+            // Estimate the quotient digit from the top two limbs, then correct it.
+            unsigned __int128 num = ((unsigned __int128)u.limbs[j + n] << 64) | u.limbs[j + n - 1];
+            unsigned __int128 qhat = num / vtop;
+            unsigned __int128 rhat = num % vtop;
+            while ((qhat >> 64) != 0 ||
+                   qhat * vnext > ((rhat << 64) | u.limbs[j + n - 2])) {
+                qhat--;
+                rhat += vtop;
+                if ((rhat >> 64) != 0) break;
+            }
+
+            // Multiply and subtract qhat * v from the current window of u.
+            uint64_t borrow = 0, carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                unsigned __int128 p = qhat * v.limbs[i] + carry;
+                carry = (uint64_t)(p >> 64);
+                uint64_t plo = (uint64_t)p;
+                uint64_t ui = u.limbs[i + j];
+                uint64_t t = ui - plo;
+                uint64_t next_borrow = ui < plo;
+                next_borrow += t < borrow;
+                u.limbs[i + j] = t - borrow;
+                borrow = next_borrow;
+            }
+            uint64_t top = u.limbs[j + n];
+            uint64_t t = top - carry;
+            uint64_t negative = top < carry;
+            negative += t < borrow;
+            u.limbs[j + n] = t - borrow;
+
+            // The estimate was one too large: add the divisor back.
+            if (negative) {
+                qhat--;
+                uint64_t c = 0;
+                for (size_t i = 0; i < n; i++) {
+                    unsigned __int128 s = (unsigned __int128)u.limbs[i + j] + v.limbs[i] + c;
+                    u.limbs[i + j] = (uint64_t)s;
+                    c = (uint64_t)(s >> 64);
                 }
+                u.limbs[j + n] += c;
             }
+            quotient.limbs[j] = (uint64_t)qhat;
+        }
+        quotient.normalize();
+        q = move(quotient);
 
-            // If no break, n is composite
-            if (!found) return false;
+        u.limbs.resize(n);
+        u.normalize();
+        u >>= shift;
+        r = move(u);
+    }
+
+    static int jacobi(BigInt a, BigInt n) {
+        /*
+        Desc: Jacobi symbol (a/n), by pulling out factors of two and applying quadratic
+                reciprocity until the top argument is zero.
+        Parameters:
+            a (BigInt): Top argument.
+            n (BigInt): Odd positive bottom argument.
+        Returns:
+            int: -1, 0 or 1.
+        */
+        if (!n.isOdd()) throw domain_error("Jacobi symbol needs an odd bottom argument");
+        a = a % n;
+        int result = 1;
+        while (!a.isZero()) {
+            size_t twos = a.trailingZeros();
+            a >>= twos;
+            uint64_t n8 = n.low() & 7;
+            if ((twos & 1) && (n8 == 3 || n8 == 5)) result = -result;  // (2/n) = -1 for n = 3, 5 mod 8
+            if ((a.low() & 3) == 3 && (n.low() & 3) == 3) result = -result;  // Both 3 mod 4
+            swap(a, n);
+            a = a % n;
         }
+        return n == BigInt(1) ? result : 0;
+    }
 
-        // If all rounds pass, n is probably prime
-        return true;
+    static BigInt isqrt(const BigInt& a) {
+        // floor(sqrt(a)) by Newton's iteration, starting from a power of two above the root.
+        if (a.isZero()) return a;
+        BigInt x = BigInt(1) << ((a.bitLength() + 1) / 2);
+        while (true) {
+            BigInt y = (x + a / x) >> 1;
+            if (y >= x) return x;
+            x = move(y);
+        }
+    }
+
+    bool isSquare() const {
+        /*
+        Desc: Whether the number is a perfect square. Residues mod 64, 63, 65 and 11 reject all but
+                about 0.6% of non-squares before the square root is taken.
+        */
+        static constexpr auto squares = [] {
+            // squares[m][r]: whether r is a square mod m, for the moduli used below
+            array<array<bool, 65>, 4> table{};
+            const unsigned moduli[] = {64, 63, 65, 11};
+            for (int i = 0; i < 4; i++) {
+                for (unsigned x = 0; x < moduli[i]; x++) table[i][x * x % moduli[i]] = true;
+            }
+            return table;
+        }();
+        if (!squares[0][low() & 63]) return false;
+        BigInt rest = *this;
+        uint64_t r = rest.divSmall(63 * 65 * 11);
+        if (!squares[1][r % 63] || !squares[2][r % 65] || !squares[3][r % 11]) return false;
+        BigInt root = isqrt(*this);
+        return square(root) == *this;
     }
 
-    // Power function used in Miller-Rabin (Exponentiation by Squaring)
-    static uint64_t power(uint64_t base, uint64_t exp, uint64_t mod) {
+    // Digits per leaf of the divide-and-conquer parser, a multiple of 16; shorter runs are
+    // converted directly, 16 digits per multiply. Tuned with `p2 --bench` (parsing table).
+    static const size_t PARSE_LEAF_DIGITS = 512;
+
+    static BigInt fromDecimal(const string& digits) {
         /*
-        Desc: Computes (base^exp) % mod using Exponentiation by Squaring.
+        Desc: Parses a string of decimal digits. The string is validated 16 characters at a
+                time, then split in two around a power of ten, recursively, and the halves are
+                joined with one fast multiply each, so the cost is O(M(n) log n) rather than
+                quadratic.
         Parameters:
-            base (uint64_t): Base of the exponentiation.
-            exp (uint64_t): Exponent.
-            mod (uint64_t): Modulus.
+            digits (const string&): The number as a string of at least one digit.
         Returns:
-            uint64_t: Result of (base^exp) % mod.
+            BigInt: The parsed number.
         */
-        uint64_t result = 1;  // Initialize result to 1
-        base = base % mod;    // Mod the base to reduce its size
+        if (digits.empty() || !allDigits(digits.data(), digits.size())) {
+            throw invalid_argument("not a decimal number: \"" + digits + "\"");
+        }
+        vector<BigInt> powers; // powers[i] = 10^(PARSE_LEAF_DIGITS * 2^i), filled in as needed
+        return parseDigits(digits.data(), digits.size(), powers);
+    }
 
-        while (exp > 0) {
-            // If the exponent is odd, multiply base with result
-            if (exp % 2 == 1) {
-                result = (result * base) % mod;
+    static bool allDigits(const char* s, size_t n) {
+        // Whether every character is '0'..'9'. SSE2 checks 16 characters per compare.
+        size_t i = 0;
+#if defined(__x86_64__)
+        const __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+        for (; i + 16 <= n; i += 16) {
+            // c - '0' as an unsigned byte is at most 9 exactly for digits
+            __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(s + i)), zero);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine)) != 0xffff) return false;
+        }
+#endif
+        for (; i < n; i++) {
+            if (s[i] < '0' || s[i] > '9') return false;
+        }
+        return true;
+    }
+
+    static uint64_t parseEightDigits(const char* s) {
+        // SWAR conversion of 8 digits in one word: adjacent digits, then pairs, then quads are
+        // combined by multiplies that place each group at its power of ten.
+        uint64_t v;
+        memcpy(&v, s, 8);
+        v -= 0x3030303030303030ULL;
+        v = v * 10 + (v >> 8);
+        return (uint32_t)((((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+                           (((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32);
+    }
+
+    static BigInt parseLeaf(const char* s, size_t n) {
+        // Direct conversion of validated digits: the leading n % 16 digits, then one multiply
+        // by 10^16 per 16 digits.
+        BigInt result;
+        size_t head = n % 16;
+        uint64_t first = 0;
+        for (size_t i = 0; i < head; i++) first = first * 10 + (s[i] - '0');
+        if (first) result.limbs.push_back(first);
+        for (size_t i = head; i < n; i += 16) {
+            uint64_t chunk = parseEightDigits(s + i) * 100000000ULL + parseEightDigits(s + i + 8);
+            if (result.isZero()) result = BigInt(chunk);
+            else result.mulSmall(10000000000000000ULL, chunk);
+        }
+        return result;
+    }
+
+    static BigInt parseDigits(const char* s, size_t n, vector<BigInt>& powers) {
+        /*
+        Desc: Converts validated digits by splitting off the largest low part of
+                PARSE_LEAF_DIGITS * 2^i digits: value = high * 10^(low digits) + low.
+        Parameters:
+            s (const char*), n (size_t): The digits.
+            powers (vector<BigInt>&): Cache of the powers of ten used for joining.
+        */
+        if (n <= PARSE_LEAF_DIGITS) return parseLeaf(s, n);
+        size_t level = 0;
+        while ((PARSE_LEAF_DIGITS << (level + 1)) < n) level++;
+        size_t low_digits = PARSE_LEAF_DIGITS << level;
+        while (powers.size() <= level) {
+            if (powers.empty()) {
+                BigInt leaf_power(1);
+                for (size_t i = 0; i < PARSE_LEAF_DIGITS; i += 16) leaf_power.mulSmall(10000000000000000ULL, 0);
+                powers.push_back(leaf_power);
+            } else {
+                powers.push_back(square(powers.back()));
             }
-            exp = exp >> 1;  // Divide exponent by 2 (right shift)
-            base = (base * base) % mod;  // Square the base and mod it
         }
+        BigInt high = parseDigits(s, n - low_digits, powers);
+        BigInt low = parseDigits(s + n - low_digits, low_digits, powers);
+        return high * powers[level] + low;
+    }
 
-        return result;  // Return the final result
+    // Digits per leaf of the divide-and-conquer printer, a multiple of 19; leaves are converted
+    // by repeated division by 10^19.
+    static const size_t PRINT_LEAF_DIGITS = 608;
+
+    string toString() const;
+    static BigInt reciprocal(const BigInt& d);
+    static void divmodByReciprocal(const BigInt& x, const BigInt& d, const BigInt& inv, BigInt& q, BigInt& r);
+
+    static void writeLeaf(BigInt x, char* out, size_t width) {
+        /*
+        Desc: Writes x as the last digits of a width-digit field already filled with '0', 19
+                digits per division.
+        */
+        size_t pos = width;
+        while (!x.isZero()) {
+            uint64_t chunk = x.divSmall(10000000000000000000ULL);
+            for (int i = 0; i < 19 && pos > 0; i++) {
+                out[--pos] = '0' + chunk % 10;
+                chunk /= 10;
+            }
+        }
     }
+};
 
-private:
-    // Recursive function to print the number from most to least significant
-    void printRecursive(Node* node) const {
-        if (node == nullptr) return; // Base case: nothing to print
-        printRecursive(node->next); // Recursively print the next node
-        cout << node->value << " "; // Print the current node value
+// A BigInt with a sign, for the negative values that appear inside Toom-3.
+struct SignedBigInt {
+    BigInt mag;        // Magnitude
+    bool neg = false;  // Whether the value is negative (never set for zero)
+
+    SignedBigInt() {}
+    SignedBigInt(const BigInt& m, bool n = false) : mag(m), neg(n && !m.isZero()) {}
+
+    friend SignedBigInt operator+(const SignedBigInt& a, const SignedBigInt& b) {
+        if (a.neg == b.neg) return SignedBigInt(a.mag + b.mag, a.neg);
+        if (a.mag >= b.mag) return SignedBigInt(a.mag - b.mag, a.neg);
+        return SignedBigInt(b.mag - a.mag, b.neg);
+    }
+
+    friend SignedBigInt operator-(const SignedBigInt& a, const SignedBigInt& b) {
+        return a + SignedBigInt(b.mag, !b.neg);
+    }
+
+    friend SignedBigInt operator*(const SignedBigInt& a, const SignedBigInt& b) {
+        return SignedBigInt(a.mag * b.mag, a.neg != b.neg);
+    }
+
+    SignedBigInt divExact(uint64_t d) const {
+        // Division by a small number that is known to leave no remainder.
+        BigInt q = mag;
+        q.divSmall(d);
+        return SignedBigInt(q, neg);
     }
 };
 
-// Helper function to split the large number into chunks of 19 digits
-vector<uint64_t> splitNumberIntoChunks(const string& number, size_t maxSize) {
+static void toom3Interpolate(uint64_t* r, size_t rn, size_t k, const SignedBigInt& r0, const SignedBigInt& r1,
+                             const SignedBigInt& rm1, const SignedBigInt& rm2, const SignedBigInt& rinf) {
+    /*
+    Desc: Recovers the five coefficients of the product polynomial from its values at
+            0, 1, -1, -2 and infinity (Bodrato's sequence) and adds them up at k-limb offsets.
+    Parameters:
+        r (uint64_t*), rn (size_t): Output limbs of the full product.
+        k (size_t): Number of limbs per Toom-3 part.
+    */
+    SignedBigInt c3 = (rm2 - r1).divExact(3);
+    SignedBigInt c1 = (r1 - rm1).divExact(2);
+    SignedBigInt c2 = rm1 - r0;
+    c3 = (c2 - c3).divExact(2) + rinf + rinf;
+    c2 = c2 + c1 - rinf;
+    c1 = c1 - c3;
+
+    memset(r, 0, rn * sizeof(uint64_t));
+    const SignedBigInt* coeffs[5] = {&r0, &c1, &c2, &c3, &rinf};
+    for (int i = 0; i < 5; i++) {
+        const BigInt& c = coeffs[i]->mag; // Every coefficient of a product of non-negatives is >= 0
+        if (!c.isZero()) BigInt::addInto(r + i * k, rn - i * k, c.limbs.data(), c.limbs.size());
+    }
+}
+
+BigInt BigInt::reciprocal(const BigInt& d) {
     /*
-    Desc: Splits a large string number into chunks of up to 19 digits.
+    Desc: floor(2^(2n) / d) for a d of n bits, by Newton's iteration: the reciprocal of the top
+            half of d, scaled up, is refined by one step x += x (2^(2n) - d x) / 2^(2n), which
+            doubles its correct bits, and the last few units are then fixed exactly. The cost
+            is a few multiplications of n-bit numbers rather than a long division.
     Parameters:
-        number (const string&): The number as a string.
-        maxSize (size_t): Maximum size of each chunk (19 digits).
+        d (const BigInt&): The divisor, not zero.
     Returns:
-        vector<uint64_t>: Vector of chunks as 64-bit unsigned integers.
+        BigInt: The reciprocal.
     */
-    vector<uint64_t> chunks;
-    size_t length = number.size();
+    size_t n = d.bitLength();
+    if (n <= 512) return (BigInt(1) << (2 * n)) / d;
+    size_t h = n / 2 + 8; // Bits of d the first approximation is taken from
+    BigInt x = reciprocal(d >> (n - h)) << (n - h);
+    BigInt top = BigInt(1) << (2 * n);
+    SignedBigInt e = SignedBigInt(top) - SignedBigInt(d * x);
+    x = (SignedBigInt(x) + SignedBigInt((x * e.mag) >> (2 * n), e.neg)).mag;
+
+    e = SignedBigInt(top) - SignedBigInt(d * x);
+    while (e.neg) {
+        x -= BigInt(1);
+        e = e + SignedBigInt(d);
+    }
+    while (e.mag >= d) {
+        x += BigInt(1);
+        e = e - SignedBigInt(d);
+    }
+    return x;
+}
 
-    // Split the number into 19-digit chunks starting from the least significant part
-    for (int i = length; i > 0; i -= maxSize) {
-        size_t start = (i >= maxSize) ? i - maxSize : 0;  // Determine the starting point of the chunk
-        size_t size = (i >= maxSize) ? maxSize : i;       // Determine the size of the chunk
-        string chunkStr = number.substr(start, size);     // Extract the chunk substring
+void BigInt::divmodByReciprocal(const BigInt& x, const BigInt& d, const BigInt& inv, BigInt& q, BigInt& r) {
+    /*
+    Desc: Barrett division: the quotient estimate from the precomputed reciprocal is at most
+            two below the true one, and is fixed by subtracting d.
+    Parameters:
+        x (const BigInt&): Dividend, below 2^(2n) for d of n bits.
+        d (const BigInt&): Divisor.
+        inv (const BigInt&): reciprocal(d).
+        q (BigInt&), r (BigInt&): Receive the quotient and remainder.
+    */
+    size_t n = d.bitLength();
+    q = ((x >> (n - 1)) * inv) >> (n + 1);
+    r = x - q * d;
+    while (r >= d) {
+        r -= d;
+        q += BigInt(1);
+    }
+}
 
-        uint64_t chunkValue = stoull(chunkStr);           // Convert the chunk to an unsigned 64-bit integer
-        chunks.push_back(chunkValue);                     // Add the chunk to the vector
+static void writeDecimal(const BigInt& x, char* out, int level, vector<BigInt>& powers, vector<BigInt>& inverses) {
+    /*
+    Desc: Writes x < powers[level]^2 as exactly 2 * PRINT_LEAF_DIGITS * 2^level digits: the
+            quotient and remainder by powers[level] each fill one half.
+    Parameters:
+        out (char*): The field, already filled with '0'.
+        level (int): -1 for a leaf, x < 10^PRINT_LEAF_DIGITS, filling PRINT_LEAF_DIGITS digits.
+        powers (vector<BigInt>&): powers[i] = 10^(PRINT_LEAF_DIGITS * 2^i).
+        inverses (vector<BigInt>&): Reciprocals of the powers, computed on first use.
+    */
+    if (level < 0) {
+        BigInt::writeLeaf(x, out, BigInt::PRINT_LEAF_DIGITS);
+        return;
     }
+    if (x.isZero()) return;
+    if (inverses[level].isZero()) inverses[level] = BigInt::reciprocal(powers[level]);
+    BigInt q, r;
+    BigInt::divmodByReciprocal(x, powers[level], inverses[level], q, r);
+    size_t half = BigInt::PRINT_LEAF_DIGITS << level;
+    writeDecimal(q, out, level - 1, powers, inverses);
+    writeDecimal(r, out + half, level - 1, powers, inverses);
+}
 
-    return chunks; // Return the vector of chunks
+string BigInt::toString() const {
+    /*
+    Desc: Converts the number to decimal by divide and conquer: it is split by the largest
+            power 10^(PRINT_LEAF_DIGITS * 2^i) whose square exceeds it, each half recursively,
+            with the divisions done by precomputed reciprocals. All digits are written into
+            one preallocated string, and the leading zeros are trimmed at the end.
+    Returns:
+        string: The number in decimal.
+    */
+    if (isZero()) return "0";
+    vector<BigInt> powers, inverses;
+    BigInt leaf_power(1);
+    for (size_t i = 0; i < PRINT_LEAF_DIGITS; i += 19) leaf_power.mulSmall(10000000000000000000ULL, 0);
+    powers.push_back(leaf_power);
+    while (powers.back().bitLength() <= bitLength()) powers.push_back(square(powers.back()));
+    int level = (int)powers.size() - 2; // powers[level + 1] = powers[level]^2 > *this
+
+    string out((PRINT_LEAF_DIGITS << (level + 1)), '0');
+    inverses.resize(powers.size());
+    writeDecimal(*this, out.data(), level, powers, inverses);
+    out.erase(0, out.find_first_not_of('0'));
+    return out;
+}
+
+static BigInt limbSlice(const uint64_t* a, size_t n, size_t from, size_t len) {
+    // The number formed by limbs [from, from + len) of an n-limb array.
+    BigInt out;
+    if (from < n) out.limbs.assign(a + from, min(len, n - from));
+    out.normalize();
+    return out;
+}
+
+void BigInt::mulToom3(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    /*
+    Desc: One level of Toom-3 for two n-limb operands: each is split into three parts,
+            seen as a quadratic polynomial, and the product is rebuilt from five
+            third-size products at the points 0, 1, -1, -2 and infinity.
+    */
+    size_t k = (n + 2) / 3;
+    SignedBigInt a0(limbSlice(a, n, 0, k)), a1(limbSlice(a, n, k, k)), a2(limbSlice(a, n, 2 * k, k));
+    SignedBigInt b0(limbSlice(b, n, 0, k)), b1(limbSlice(b, n, k, k)), b2(limbSlice(b, n, 2 * k, k));
+
+    SignedBigInt pa = a0 + a2, pb = b0 + b2;
+    SignedBigInt a_1 = pa + a1, b_1 = pb + b1;       // Values at 1
+    SignedBigInt a_m1 = pa - a1, b_m1 = pb - b1;     // Values at -1
+    SignedBigInt a_m2 = (a_m1 + a2) + (a_m1 + a2) - a0;
+    SignedBigInt b_m2 = (b_m1 + b2) + (b_m1 + b2) - b0;
+
+    toom3Interpolate(r, 2 * n, k, a0 * b0, a_1 * b_1, a_m1 * b_m1, a_m2 * b_m2, a2 * b2);
+}
+
+void BigInt::sqrToom3(uint64_t* r, const uint64_t* a, size_t n) {
+    // One level of Toom-3 squaring; the five pointwise products are squares.
+    size_t k = (n + 2) / 3;
+    SignedBigInt a0(limbSlice(a, n, 0, k)), a1(limbSlice(a, n, k, k)), a2(limbSlice(a, n, 2 * k, k));
+
+    SignedBigInt pa = a0 + a2;
+    SignedBigInt a_1 = pa + a1, a_m1 = pa - a1;
+    SignedBigInt a_m2 = (a_m1 + a2) + (a_m1 + a2) - a0;
+    auto sq = [](const SignedBigInt& x) { return SignedBigInt(BigInt::square(x.mag)); };
+
+    toom3Interpolate(r, 2 * n, k, sq(a0), sq(a_1), sq(a_m1), sq(a_m2), sq(a2));
 }
 
-int main() {
+template <class Context, class Element>
+Element slidingWindowPower(const Context& ctx, const Element& base, const BigInt& exp,
+                           const atomic<bool>* cancel = nullptr) {
+    /*
+    Desc: Left-to-right sliding window exponentiation of a number in Montgomery form. Each window
+            of up to w bits ending in a 1 costs one multiply by a precomputed odd power of the
+            base. Shared by the arbitrary-precision and the fixed-width Montgomery contexts.
+    Parameters:
+        ctx (const Context&): Montgomery context providing mul(), sqr(), one, size (limbs per
+            element) and windowSize(); the table of powers lives in scratch memory.
+        base (const Element&): Base, in Montgomery form.
+        exp (const BigInt&): Exponent.
+        cancel (const atomic<bool>*): Optional flag checked between windows; once it is set the
+            function returns early with a meaningless result.
+    Returns:
+        Element: base^exp, still in Montgomery form.
+    */
+    size_t bits = exp.bitLength();
+    int w = Context::windowSize(bits);
+    if (w == 1) return ctx.powerBinary(base, exp);
+
+    // Row i of the table holds base^(2i+1), in scratch memory
+    size_t L = ctx.size, entries = size_t(1) << (w - 1);
+    ScratchArena::Frame frame;
+    uint64_t *table = frame.alloc(entries * L), *base2 = frame.alloc(L);
+    memcpy(table, base.data(), L * sizeof(uint64_t));
+    ctx.sqr(base2, base.data());
+    for (size_t i = 1; i < entries; i++) ctx.mul(table + i * L, table + (i - 1) * L, base2);
+
+    Element result = ctx.one;
+    bool started = false; // Whether result holds anything but 1 yet
+    for (long i = (long)bits - 1; i >= 0;) {
+        if (cancel && cancel->load(memory_order_relaxed)) break;
+        if (!exp.bit(i)) {
+            if (started) ctx.sqr(result.data(), result.data());
+            i--;
+            continue;
+        }
+        // Longest window of at most w bits starting at bit i and ending in a 1
+        long low = max(i - w + 1, 0L);
+        while (!exp.bit(low)) low++;
+        uint64_t window = 0;
+        for (long j = i; j >= low; j--) window = (window << 1) | exp.bit(j);
+
+        if (started) {
+            for (long j = i; j >= low; j--) ctx.sqr(result.data(), result.data());
+            ctx.mul(result.data(), result.data(), table + (window >> 1) * L);
+        } else {
+            memcpy(result.data(), table + (window >> 1) * L, L * sizeof(uint64_t));
+            started = true;
+        }
+        i = low - 1;
+    }
+    return result;
+}
+
+// Montgomery arithmetic modulo a fixed odd number n of N limbs, with R = 2^(64N).
+// Numbers in Montgomery form are kept as exactly N limbs (a * R mod n), so a modular
+// multiply needs no division: the reduction only uses multiplies by n and the constant n'.
+class MontgomeryContext {
+public:
+    typedef LimbVector Element; // Numbers in Montgomery form
+
+    BigInt modulus;      // The odd modulus n
+    size_t size;         // Number of limbs N of the modulus
+    uint64_t n_prime;    // -n^(-1) mod 2^64
+    LimbVector r2;       // R^2 mod n, used to convert into Montgomery form
+    LimbVector one;      // R mod n, i.e. 1 in Montgomery form
+
+    MontgomeryContext(const BigInt& n) {
+        /*
+        Desc: Precomputes the constants for modulus n. Built once per modulus and reused.
+        Parameters:
+            n (const BigInt&): Odd modulus greater than 1.
+        */
+        if (!n.isOdd() || n <= BigInt(1)) throw domain_error("Montgomery modulus must be odd and > 1");
+        modulus = n;
+        size = n.limbs.size();
+
+        // Newton iteration for n0^(-1) mod 2^64; each step doubles the number of correct bits.
+        uint64_t inv = n.limbs[0];
+        for (int i = 0; i < 5; i++) inv *= 2 - n.limbs[0] * inv;
+        n_prime = -inv;
+
+        r2 = padded((BigInt(1) << (128 * size)) % n);
+        one = padded((BigInt(1) << (64 * size)) % n);
+    }
+
+    LimbVector padded(const BigInt& a) const {
+        // Copies a reduced number into exactly N limbs.
+        LimbVector out;
+        out.assign(a.limbs.data(), a.limbs.size());
+        out.resize(size);
+        return out;
+    }
+
+    LimbVector toMontgomery(const BigInt& a) const {
+        /*
+        Desc: Converts a number into Montgomery form (a * R mod n).
+        */
+        LimbVector out;
+        out.resize(size);
+        mul(out.data(), padded(a % modulus).data(), r2.data());
+        return out;
+    }
+
+    BigInt fromMontgomery(const LimbVector& a) const {
+        /*
+        Desc: Converts a number out of Montgomery form (a * R^(-1) mod n).
+        */
+        LimbVector unit;
+        unit.resize(size);
+        unit[0] = 1;
+        BigInt out;
+        out.limbs.resize(size);
+        mul(out.limbs.data(), a.data(), unit.data());
+        out.normalize();
+        return out;
+    }
+
+    void mul(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        /*
+        Desc: Montgomery product out = a * b * R^(-1) mod n. Wide moduli form the full product
+                with the fast multiplication and reduce it afterwards; narrower ones use CIOS.
+        Parameters:
+            out (uint64_t*): N limbs receiving the product; may alias a or b.
+            a, b (const uint64_t*): N limbs each, both less than n.
+        */
+        if (size < BigInt::KARATSUBA_MUL_THRESHOLD) {
+            mulCIOS(out, a, b);
+            return;
+        }
+        ScratchArena::Frame frame;
+        uint64_t* t = frame.alloc(2 * size);
+        BigInt::mulLimbs(t, a, size, b, size);
+        reduce(out, t);
+    }
+
+    void sqr(uint64_t* out, const uint64_t* a) const {
+        /*
+        Desc: Montgomery square out = a * a * R^(-1) mod n. The square is formed on its own
+                (about half the limb multiplies of a product) and then reduced.
+        Parameters:
+            out (uint64_t*): N limbs receiving the square; may alias a.
+            a (const uint64_t*): N limbs, less than n.
+        */
+        uint64_t t[2 * LimbVector::INLINE_LIMBS];
+        ScratchArena::Frame frame;
+        uint64_t* T = size > LimbVector::INLINE_LIMBS ? frame.alloc(2 * size) : t;
+        BigInt::sqrLimbs(T, a, size);
+        reduce(out, T);
+    }
+
+    void reduce(uint64_t* out, uint64_t* t) const {
+        /*
+        Desc: Montgomery reduction out = t * R^(-1) mod n of a 2N-limb t < n * R, one word at a time.
+        Parameters:
+            out (uint64_t*): N limbs receiving the result.
+            t (uint64_t*): 2N limbs; overwritten.
+        */
+        size_t N = size;
+        const uint64_t* m = modulus.limbs.data();
+        uint64_t extra = 0; // Carry out of the top limb handled so far
+        for (size_t i = 0; i < N; i++) {
+            // Add q * n * 2^(64i), with q chosen so limb i becomes zero
+            uint64_t q = t[i] * n_prime;
+            uint64_t carry = 0;
+            for (size_t j = 0; j < N; j++) {
+                unsigned __int128 r = (unsigned __int128)q * m[j] + t[i + j] + carry;
+                t[i + j] = (uint64_t)r;
+                carry = (uint64_t)(r >> 64);
+            }
+            unsigned __int128 s = (unsigned __int128)t[i + N] + carry + extra;
+            t[i + N] = (uint64_t)s;
+            extra = (uint64_t)(s >> 64);
+        }
+        uint64_t* T = t + N;
+        if (extra || !lessThanModulus(T)) BigInt::subLimbs(T, T, N, m, N);
+        memcpy(out, T, N * sizeof(uint64_t));
+    }
+
+    bool lessThanModulus(const uint64_t* a) const {
+        // Whether an N-limb number is below n.
+        const uint64_t* m = modulus.limbs.data();
+        for (size_t j = size; j-- > 0;) {
+            if (a[j] != m[j]) return a[j] < m[j];
+        }
+        return false;
+    }
+
+    void add(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a + b mod n, for N-limb a, b < n. Works on Montgomery form as on plain residues.
+        uint64_t carry = BigInt::addLimbs(out, a, size, b, size);
+        if (carry || !lessThanModulus(out)) BigInt::subLimbs(out, out, size, modulus.limbs.data(), size);
+    }
+
+    void sub(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a - b mod n, for N-limb a, b < n.
+        if (BigInt::subLimbs(out, a, size, b, size)) BigInt::addLimbs(out, out, size, modulus.limbs.data(), size);
+    }
+
+    void half(uint64_t* out, const uint64_t* a) const {
+        // out = a / 2 mod n: an odd a is made even first by adding the odd modulus.
+        if (out != a) memcpy(out, a, size * sizeof(uint64_t));
+        uint64_t top = (out[0] & 1) ? BigInt::addLimbs(out, out, size, modulus.limbs.data(), size) : 0;
+        for (size_t j = 0; j < size; j++) out[j] = (out[j] >> 1) | ((j + 1 < size ? out[j + 1] : top) << 63);
+    }
+
+    void mulCIOS(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        /*
+        Desc: Montgomery product using the CIOS method, which interleaves each row of the
+                product with one word of reduction.
+        Parameters:
+            out (uint64_t*): N limbs receiving the product; may alias a or b.
+            a, b (const uint64_t*): N limbs each, both less than n.
+        */
+        size_t N = size;
+        const uint64_t* m = modulus.limbs.data();
+        uint64_t t[LimbVector::INLINE_LIMBS + 2];
+        ScratchArena::Frame frame;
+        uint64_t* T = N > LimbVector::INLINE_LIMBS ? frame.alloc(N + 2) : t;
+        memset(T, 0, (N + 2) * sizeof(uint64_t));
+
+        for (size_t i = 0; i < N; i++) {
+            // T += a * b[i]
+            uint64_t carry = 0;
+            for (size_t j = 0; j < N; j++) {
+                unsigned __int128 p = (unsigned __int128)a[j] * b[i] + T[j] + carry;
+                T[j] = (uint64_t)p;
+                carry = (uint64_t)(p >> 64);
+            }
+            unsigned __int128 s = (unsigned __int128)T[N] + carry;
+            T[N] = (uint64_t)s;
+            T[N + 1] = (uint64_t)(s >> 64);
+
+            // T = (T + q * n) / 2^64, with q chosen so the lowest word cancels
+            uint64_t q = T[0] * n_prime;
+            unsigned __int128 r = (unsigned __int128)q * m[0] + T[0];
+            carry = (uint64_t)(r >> 64);
+            for (size_t j = 1; j < N; j++) {
+                r = (unsigned __int128)q * m[j] + T[j] + carry;
+                T[j - 1] = (uint64_t)r;
+                carry = (uint64_t)(r >> 64);
+            }
+            s = (unsigned __int128)T[N] + carry;
+            T[N - 1] = (uint64_t)s;
+            T[N] = T[N + 1] + (uint64_t)(s >> 64);
+        }
+
+        // The result is below 2n; one conditional subtraction brings it below n.
+        if (T[N] != 0 || !lessThanModulus(T)) BigInt::subLimbs(T, T, N, m, N);
+        memcpy(out, T, N * sizeof(uint64_t));
+    }
+
+    BigInt power(const BigInt& base, const BigInt& exp) const {
+        /*
+        Desc: Computes (base^exp) % n with every multiply done in Montgomery form.
+        Parameters:
+            base (const BigInt&): Base of the exponentiation.
+            exp (const BigInt&): Exponent.
+        Returns:
+            BigInt: Result of (base^exp) % n.
+        */
+        return fromMontgomery(powerMontgomery(toMontgomery(base), exp));
+    }
+
+    static int windowSize(size_t bits) {
+        /*
+        Desc: Picks the sliding window width for an exponent, trading the size of the table of
+                odd powers against the multiplies saved per window.
+        Parameters:
+            bits (size_t): Bit length of the exponent.
+        */
+        if (bits > 671) return 6;
+        if (bits > 239) return 5;
+        if (bits > 79) return 4;
+        if (bits > 23) return 3;
+        return 1;
+    }
+
+    LimbVector powerMontgomery(const LimbVector& base, const BigInt& exp) const {
+        /*
+        Desc: Sliding window exponentiation of a number already in Montgomery form.
+        Returns:
+            LimbVector: base^exp, still in Montgomery form.
+        */
+        return slidingWindowPower(*this, base, exp);
+    }
+
+    LimbVector powerBinary(const LimbVector& base, const BigInt& exp) const {
+        /*
+        Desc: Left-to-right binary exponentiation of a number already in Montgomery form,
+                one multiply per set bit of the exponent.
+        Returns:
+            LimbVector: base^exp, still in Montgomery form.
+        */
+        LimbVector result = one;
+        for (size_t i = exp.bitLength(); i-- > 0;) {
+            sqr(result.data(), result.data());
+            if (exp.bit(i)) mul(result.data(), result.data(), base.data());
+        }
+        return result;
+    }
+};
+
+// Barrett reduction modulo a fixed n of N limbs. With mu = floor(b^(2N) / n) precomputed
+// (b = 2^64), the quotient of any x < b^(2N) by n is estimated with two multiplications and
+// comes out at most two too small. Unlike Montgomery form it works on plain residues and
+// on even moduli, so products can be reduced as they come with no conversion in or out.
+class BarrettContext {
+public:
+    typedef LimbVector Element; // Residues, kept as exactly N limbs
+
+    // Below this many limbs the two products of a reduction are schoolbook short products,
+    // above it full fast multiplications. Tuned with `p2 --bench` (reduction table).
+    static const size_t SHORT_PRODUCT_LIMBS = 128;
+
+    BigInt modulus;   // The modulus n
+    size_t size;      // Number of limbs N of the modulus
+    BigInt mu;        // floor(b^(2N) / n): N + 1 limbs, N + 2 when n = b^(N-1)
+    LimbVector one;   // 1 mod n
+
+    BarrettContext(const BigInt& n) {
+        /*
+        Desc: Precomputes mu for modulus n. Built once per modulus and reused.
+        Parameters:
+            n (const BigInt&): Modulus greater than 1, odd or even.
+        */
+        if (n <= BigInt(1)) throw domain_error("Barrett modulus must be > 1");
+        modulus = n;
+        size = n.limbs.size();
+        mu = (BigInt(1) << (128 * size)) / n;
+        one = padded(BigInt(1));
+    }
+
+    static int windowSize(size_t bits) { return MontgomeryContext::windowSize(bits); }
+
+    LimbVector padded(const BigInt& a) const {
+        // Copies a reduced number into exactly N limbs.
+        LimbVector out;
+        out.assign(a.limbs.data(), a.limbs.size());
+        out.resize(size);
+        return out;
+    }
+
+    void reduce(uint64_t* out, const uint64_t* x) const {
+        /*
+        Desc: out = x mod n for a 2N-limb x. The quotient estimate is
+                q = floor(floor(x / b^(N-1)) * mu / b^(N+1)), and x - q n, taken modulo b^(N+1),
+                is below 3n (4n with the short products), so a few subtractions finish it.
+        Parameters:
+            out (uint64_t*): N limbs receiving the remainder.
+            x (const uint64_t*): 2N limbs; left unchanged.
+        */
+        size_t N = size, M = mu.limbs.size();
+        const uint64_t* m = modulus.limbs.data();
+        ScratchArena::Frame frame;
+        uint64_t *q = frame.alloc(N + 1 + M), *qn = frame.alloc(M + N), *r = frame.alloc(N + 1);
+        if (N < SHORT_PRODUCT_LIMBS) {
+            // Only the limbs that matter of each product, about half the schoolbook work.
+            // The skipped low columns of q * mu make q at most one smaller still.
+            mulHigh(q, mu.limbs.data(), M, x + N - 1, N + 1, N - 1);
+            mulLow(qn, q + N + 1, M, m, N, N + 1);
+        } else {
+            BigInt::mulLimbs(q, mu.limbs.data(), M, x + N - 1, N + 1);
+            BigInt::mulLimbs(qn, q + N + 1, M, m, N);
+        }
+        BigInt::subLimbs(r, x, N + 1, qn, N + 1);
+        while (r[N] != 0 || !lessThanModulus(r)) r[N] -= BigInt::subLimbs(r, r, N, m, N);
+        memcpy(out, r, N * sizeof(uint64_t));
+    }
+
+    static void mulHigh(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn, size_t from) {
+        // Schoolbook a * b leaving out the terms a[j] * b[i] with i + j < from; r has an + bn limbs.
+        memset(r, 0, (an + bn) * sizeof(uint64_t));
+        for (size_t i = 0; i < bn; i++) {
+            uint64_t carry = 0;
+            for (size_t j = from > i ? from - i : 0; j < an; j++) {
+                unsigned __int128 t = (unsigned __int128)a[j] * b[i] + r[i + j] + carry;
+                r[i + j] = (uint64_t)t;
+                carry = (uint64_t)(t >> 64);
+            }
+            r[i + an] = carry;
+        }
+    }
+
+    static void mulLow(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn, size_t limbs) {
+        // The low `limbs` limbs of a * b.
+        memset(r, 0, limbs * sizeof(uint64_t));
+        for (size_t i = 0; i < min(bn, limbs); i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < an && i + j < limbs; j++) {
+                unsigned __int128 t = (unsigned __int128)a[j] * b[i] + r[i + j] + carry;
+                r[i + j] = (uint64_t)t;
+                carry = (uint64_t)(t >> 64);
+            }
+            if (i + an < limbs) r[i + an] = carry;
+        }
+    }
+
+    bool lessThanModulus(const uint64_t* a) const {
+        // Whether an N-limb number is below n.
+        const uint64_t* m = modulus.limbs.data();
+        for (size_t j = size; j-- > 0;) {
+            if (a[j] != m[j]) return a[j] < m[j];
+        }
+        return false;
+    }
+
+    void mul(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a * b mod n for N-limb residues; out may alias a or b.
+        ScratchArena::Frame frame;
+        uint64_t* t = frame.alloc(2 * size);
+        BigInt::mulLimbs(t, a, size, b, size);
+        reduce(out, t);
+    }
+
+    void sqr(uint64_t* out, const uint64_t* a) const {
+        // out = a * a mod n; out may alias a.
+        ScratchArena::Frame frame;
+        uint64_t* t = frame.alloc(2 * size);
+        BigInt::sqrLimbs(t, a, size);
+        reduce(out, t);
+    }
+
+    BigInt mulmod(const BigInt& a, const BigInt& b) const {
+        /*
+        Desc: Computes (a * b) % n.
+        Parameters:
+            a, b (const BigInt&): Residues below n.
+        Returns:
+            BigInt: The product modulo n.
+        */
+        BigInt out;
+        out.limbs.resize(size);
+        mul(out.limbs.data(), padded(a).data(), padded(b).data());
+        out.normalize();
+        return out;
+    }
+
+    BigInt reduce(const BigInt& x) const {
+        /*
+        Desc: Computes x % n for any x below b^(2N), such as a product of two residues.
+        */
+        LimbVector wide;
+        wide.assign(x.limbs.data(), x.limbs.size());
+        wide.resize(2 * size);
+        BigInt out;
+        out.limbs.resize(size);
+        reduce(out.limbs.data(), wide.data());
+        out.normalize();
+        return out;
+    }
+
+    LimbVector powerBinary(const LimbVector& base, const BigInt& exp) const {
+        // Left-to-right binary exponentiation of a residue.
+        LimbVector result = one;
+        for (size_t i = exp.bitLength(); i-- > 0;) {
+            sqr(result.data(), result.data());
+            if (exp.bit(i)) mul(result.data(), result.data(), base.data());
+        }
+        return result;
+    }
+
+    BigInt power(const BigInt& base, const BigInt& exp) const {
+        /*
+        Desc: Computes (base^exp) % n by sliding window exponentiation on plain residues.
+        */
+        BigInt out;
+        out.limbs = slidingWindowPower(*this, padded(base % modulus), exp);
+        out.normalize();
+        return out;
+    }
+};
+
+// Smallest modulus, in limbs, for which Barrett reduction beats a long division per product
+// (see p2 --bench); single-limb moduli divide with one hardware division.
+const size_t BARRETT_MIN_LIMBS = 2;
+
+// Multiplies plain residues modulo one fixed n, reducing by Barrett or by long division,
+// whichever is faster at n's size. For many independent products with the same modulus,
+// such as batch residue checks, where converting into Montgomery form does not pay.
+class ModularMultiplier {
+public:
+    BigInt modulus;                  // The modulus n
+    optional<BarrettContext> barrett; // Set when n is wide enough for Barrett to win
+
+    explicit ModularMultiplier(const BigInt& n) : modulus(n) {
+        if (n.limbs.size() >= BARRETT_MIN_LIMBS) barrett.emplace(n);
+    }
+
+    BigInt mulmod(const BigInt& a, const BigInt& b) const {
+        // (a * b) % n for residues a, b below n.
+        return barrett ? barrett->mulmod(a, b) : (a * b) % modulus;
+    }
+
+    BigInt reduce(const BigInt& x) const {
+        // x % n for x below n^2.
+        return barrett ? barrett->reduce(x) : x % modulus;
+    }
+};
+
+// Unsigned integer of exactly Bits bits held in a plain array of limbs. The limb count is a
+// compile-time constant, so loops over it can be unrolled and nothing is allocated.
+template <size_t Bits>
+struct FixedUInt {
+    static constexpr size_t LIMBS = Bits / 64;
+    uint64_t limb[LIMBS];  // Least significant first
+
+    uint64_t* data() { return limb; }
+    const uint64_t* data() const { return limb; }
+
+    static FixedUInt fromBigInt(const BigInt& a) {
+        // Copies a number of at most LIMBS limbs, zero-padding the top.
+        FixedUInt out;
+        memset(out.limb, 0, sizeof(out.limb));
+        memcpy(out.limb, a.limbs.data(), min(LIMBS, a.limbs.size()) * sizeof(uint64_t));
+        return out;
+    }
+
+    BigInt toBigInt() const {
+        BigInt out;
+        out.limbs.assign(limb, LIMBS);
+        out.normalize();
+        return out;
+    }
+
+    static int compare(const FixedUInt& a, const FixedUInt& b) {
+        for (size_t i = LIMBS; i-- > 0;) {
+            if (a.limb[i] != b.limb[i]) return a.limb[i] < b.limb[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    friend bool operator==(const FixedUInt& a, const FixedUInt& b) {
+        return memcmp(a.limb, b.limb, sizeof(a.limb)) == 0;
+    }
+};
+
+// Montgomery arithmetic for moduli of exactly Bits bits (LIMBS limbs), with every loop bound
+// known at compile time. Same interface as MontgomeryContext.
+template <size_t Bits>
+class FixedMontgomery {
+public:
+    typedef FixedUInt<Bits> Element; // Numbers in Montgomery form
+    static constexpr size_t N = Element::LIMBS;
+
+    Element modulus;   // The odd modulus n
+    size_t size;       // Number of limbs (always N)
+    uint64_t n_prime;  // -n^(-1) mod 2^64
+    Element r2;        // R^2 mod n
+    Element one;       // R mod n, i.e. 1 in Montgomery form
+
+    FixedMontgomery(const BigInt& n) {
+        // Constructor taking the constants from the arbitrary-precision context.
+        MontgomeryContext generic(n);
+        modulus = Element::fromBigInt(n);
+        size = N;
+        n_prime = generic.n_prime;
+        r2 = Element::fromBigInt(limbsToBigInt(generic.r2));
+        one = Element::fromBigInt(limbsToBigInt(generic.one));
+    }
+
+    static BigInt limbsToBigInt(const LimbVector& v) {
+        BigInt out;
+        out.limbs = v;
+        out.normalize();
+        return out;
+    }
+
+    static int windowSize(size_t bits) { return MontgomeryContext::windowSize(bits); }
+
+    Element toMontgomery(const BigInt& a) const {
+        // Converts a number into Montgomery form (a * R mod n).
+        Element out = Element::fromBigInt(a % modulus.toBigInt());
+        mul(out.data(), out.data(), r2.data());
+        return out;
+    }
+
+    BigInt fromMontgomery(const Element& a) const {
+        // Converts a number out of Montgomery form (a * R^(-1) mod n).
+        uint64_t t[2 * N] = {};
+        memcpy(t, a.limb, sizeof(a.limb));
+        Element out;
+        reduce(out.data(), t);
+        return out.toBigInt();
+    }
+
+    void mul(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // Montgomery product out = a * b * R^(-1) mod n (CIOS). out may alias a or b.
+        const uint64_t* m = modulus.limb;
+        uint64_t T[N + 2] = {};
+        for (size_t i = 0; i < N; i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < N; j++) {
+                unsigned __int128 p = (unsigned __int128)a[j] * b[i] + T[j] + carry;
+                T[j] = (uint64_t)p;
+                carry = (uint64_t)(p >> 64);
+            }
+            unsigned __int128 s = (unsigned __int128)T[N] + carry;
+            T[N] = (uint64_t)s;
+            T[N + 1] = (uint64_t)(s >> 64);
+
+            uint64_t q = T[0] * n_prime;
+            unsigned __int128 r = (unsigned __int128)q * m[0] + T[0];
+            carry = (uint64_t)(r >> 64);
+            for (size_t j = 1; j < N; j++) {
+                r = (unsigned __int128)q * m[j] + T[j] + carry;
+                T[j - 1] = (uint64_t)r;
+                carry = (uint64_t)(r >> 64);
+            }
+            s = (unsigned __int128)T[N] + carry;
+            T[N - 1] = (uint64_t)s;
+            T[N] = T[N + 1] + (uint64_t)(s >> 64);
+        }
+        if (T[N] != 0 || !lessThanModulus(T)) BigInt::subLimbs(T, T, N, m, N);
+        memcpy(out, T, N * sizeof(uint64_t));
+    }
+
+    void sqr(uint64_t* out, const uint64_t* a) const {
+        // Montgomery square out = a * a * R^(-1) mod n: schoolbook square, then reduction.
+        uint64_t t[2 * N] = {};
+        for (size_t i = 0; i < N; i++) {
+            // Cross products a[i] * a[j] for j > i
+            uint64_t carry = 0;
+            for (size_t j = i + 1; j < N; j++) {
+                unsigned __int128 p = (unsigned __int128)a[i] * a[j] + t[i + j] + carry;
+                t[i + j] = (uint64_t)p;
+                carry = (uint64_t)(p >> 64);
+            }
+            t[i + N] = carry;
+        }
+        uint64_t top = 0, carry = 0;
+        for (size_t i = 0; i < N; i++) {
+            // Double the cross products and add the squares on the diagonal
+            unsigned __int128 sq = (unsigned __int128)a[i] * a[i];
+            uint64_t lo = (t[2 * i] << 1) | top;
+            uint64_t hi = (t[2 * i + 1] << 1) | (t[2 * i] >> 63);
+            top = t[2 * i + 1] >> 63;
+            unsigned __int128 s = (unsigned __int128)lo + (uint64_t)sq + carry;
+            t[2 * i] = (uint64_t)s;
+            s = (unsigned __int128)hi + (uint64_t)(sq >> 64) + (uint64_t)(s >> 64);
+            t[2 * i + 1] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
+        }
+        reduce(out, t);
+    }
+
+    void reduce(uint64_t* out, uint64_t* t) const {
+        // Montgomery reduction out = t * R^(-1) mod n of a 2N-limb t < n * R; t is overwritten.
+        const uint64_t* m = modulus.limb;
+        uint64_t extra = 0;
+        for (size_t i = 0; i < N; i++) {
+            uint64_t q = t[i] * n_prime;
+            uint64_t carry = 0;
+            for (size_t j = 0; j < N; j++) {
+                unsigned __int128 r = (unsigned __int128)q * m[j] + t[i + j] + carry;
+                t[i + j] = (uint64_t)r;
+                carry = (uint64_t)(r >> 64);
+            }
+            unsigned __int128 s = (unsigned __int128)t[i + N] + carry + extra;
+            t[i + N] = (uint64_t)s;
+            extra = (uint64_t)(s >> 64);
+        }
+        uint64_t* T = t + N;
+        if (extra || !lessThanModulus(T)) BigInt::subLimbs(T, T, N, m, N);
+        memcpy(out, T, N * sizeof(uint64_t));
+    }
+
+    bool lessThanModulus(const uint64_t* a) const {
+        for (size_t j = N; j-- > 0;) {
+            if (a[j] != modulus.limb[j]) return a[j] < modulus.limb[j];
+        }
+        return false;
+    }
+
+    void add(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a + b mod n.
+        uint64_t carry = BigInt::addLimbs(out, a, N, b, N);
+        if (carry || !lessThanModulus(out)) BigInt::subLimbs(out, out, N, modulus.limb, N);
+    }
+
+    void sub(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a - b mod n.
+        if (BigInt::subLimbs(out, a, N, b, N)) BigInt::addLimbs(out, out, N, modulus.limb, N);
+    }
+
+    void half(uint64_t* out, const uint64_t* a) const {
+        // out = a / 2 mod n.
+        if (out != a) memcpy(out, a, N * sizeof(uint64_t));
+        uint64_t top = (out[0] & 1) ? BigInt::addLimbs(out, out, N, modulus.limb, N) : 0;
+        for (size_t j = 0; j < N; j++) out[j] = (out[j] >> 1) | ((j + 1 < N ? out[j + 1] : top) << 63);
+    }
+
+    Element powerMontgomery(const Element& base, const BigInt& exp) const {
+        // Sliding window exponentiation of a number already in Montgomery form.
+        return slidingWindowPower(*this, base, exp);
+    }
+
+    Element powerBinary(const Element& base, const BigInt& exp) const {
+        // Left-to-right binary exponentiation of a number already in Montgomery form.
+        Element result = one;
+        for (size_t i = exp.bitLength(); i-- > 0;) {
+            sqr(result.data(), result.data());
+            if (exp.bit(i)) mul(result.data(), result.data(), base.data());
+        }
+        return result;
+    }
+
+    BigInt power(const BigInt& base, const BigInt& exp) const {
+        // Computes (base^exp) % n.
+        return fromMontgomery(powerMontgomery(toMontgomery(base), exp));
+    }
+};
+
+// Montgomery arithmetic modulo an odd n below 2^64, with R = 2^64. Every value is a single
+// uint64_t and every product one 128-bit multiply, so the 64-bit primality test never builds a BigInt.
+struct Montgomery64 {
+    uint64_t n;        // The odd modulus
+    uint64_t n_inv;    // n^(-1) mod 2^64
+    uint64_t r2;       // R^2 mod n
+    uint64_t one;      // R mod n, i.e. 1 in Montgomery form
+
+    explicit Montgomery64(uint64_t modulus) {
+        n = modulus;
+        n_inv = n;
+        for (int i = 0; i < 5; i++) n_inv *= 2 - n * n_inv;
+        one = (0 - n) % n;
+        r2 = (uint64_t)((unsigned __int128)one * one % n);
+    }
+
+    uint64_t reduce(unsigned __int128 t) const {
+        // t * R^(-1) mod n for t < n * R. Subtracting m * n (rather than adding) keeps the
+        // intermediate within 64 bits even when n is above 2^63.
+        uint64_t m = (uint64_t)t * n_inv;
+        uint64_t hi = (uint64_t)(t >> 64), mn = (uint64_t)(((unsigned __int128)m * n) >> 64);
+        return hi >= mn ? hi - mn : hi - mn + n;
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce((unsigned __int128)a * b); }
+    uint64_t toMontgomery(uint64_t a) const { return mul(a % n, r2); }
+
+    template <size_t Count>
+    bool strongProbablePrime(const uint64_t (&bases)[Count]) const {
+        /*
+        Desc: Strong probable-prime test of n to several bases at once. The exponentiations are
+                independent, so running them in lockstep lets the CPU overlap their multiplies.
+        Parameters:
+            bases (const uint64_t (&)[Count]): The bases; one divisible by n is skipped.
+        Returns:
+            bool: False if some base is a witness that n is composite.
+        */
+        uint64_t nMinus1 = n - 1;
+        int s = __builtin_ctzll(nMinus1);
+        uint64_t d = nMinus1 >> s;
+        uint64_t b[Count], x[Count];
+        for (size_t j = 0; j < Count; j++) x[j] = b[j] = toMontgomery(bases[j]);
+        for (int i = 62 - __builtin_clzll(d); i >= 0; i--) {
+            // The top bit of d is already in x
+            for (size_t j = 0; j < Count; j++) x[j] = mul(x[j], x[j]);
+            if ((d >> i) & 1) {
+                for (size_t j = 0; j < Count; j++) x[j] = mul(x[j], b[j]);
+            }
+        }
+
+        uint64_t minusOne = n - one;  // n-1 in Montgomery form
+        for (size_t j = 0; j < Count; j++) {
+            if (b[j] == 0 || x[j] == one || x[j] == minusOne) continue;
+            bool found = false;
+            for (int r = 1; r < s && !found; r++) {
+                x[j] = mul(x[j], x[j]);
+                found = x[j] == minusOne;
+            }
+            if (!found) return false;
+        }
+        return true;
+    }
+};
+
+// Vectorized Montgomery multiplication. The modulus and operands are split into small limbs
+// (26 bits for AVX2, 52 bits for AVX-512 IFMA) held one per 64-bit lane, so products can be
+// accumulated in the lanes without carrying; carries are resolved once per multiply.
+// The kernel is picked from the CPU at startup. Without either extension the 64-bit scalar
+// Montgomery code is used instead.
+enum MulKernel { KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512_IFMA };
+
+MulKernel detectMulKernel() {
+    // Picks the widest multiply kernel the CPU supports.
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512ifma")) return KERNEL_AVX512_IFMA;
+    if (__builtin_cpu_supports("avx2")) return KERNEL_AVX2;
+#endif
+    return KERNEL_SCALAR;
+}
+
+const MulKernel activeMulKernel = detectMulKernel(); // Chosen once at startup
+
+// Crossover points, in modulus bits, above which Miller-Rabin uses the vector kernels.
+// Below them the scalar code, with its cheaper squaring, is faster.
+const size_t SIMD_MIN_BITS_IFMA = 1500;
+const size_t SIMD_MIN_BITS_AVX2 = 2000;
+const size_t BATCH_MIN_BITS = 512;  // Smallest modulus for which IFMA batches the rounds
+
+// Widest moduli, in limbs L, the kernels handle. A lane of the accumulator collects up to 4L
+// unreduced products below 2^52 with IFMA (low and high halves of a * b[i] and q * m) and 2L
+// with AVX2, and must stay below 2^64; a few limbs under 1024 and 2048 leave room for the
+// carries. Wider moduli use the scalar code.
+const size_t SIMD_MAX_LIMBS_IFMA = 1016;
+const size_t SIMD_MAX_LIMBS_AVX2 = 2040;
+
+const char* mulKernelName(MulKernel kernel) {
+    switch (kernel) {
+        case KERNEL_AVX2: return "avx2";
+        case KERNEL_AVX512_IFMA: return "avx512-ifma";
+        default: return "scalar";
+    }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("avx2")))
+static void montMulAvx2(uint64_t* acc, const uint64_t* a, const uint64_t* b, const uint64_t* m,
+                        uint64_t k0, size_t L) {
+    /*
+    Desc: Radix 2^26 Montgomery product kernel. acc (2L + 4 lanes, zeroed) receives
+            (a * b + q * m) / 2^(26i) row by row; row i adds into acc[i, i + L).
+            Each 26 x 26 bit product fits a lane with room for all L rows.
+    */
+    const uint64_t mask = (1ULL << 26) - 1;
+    for (size_t i = 0; i < L; i++) {
+        uint64_t q = ((acc[i] + a[0] * b[i]) * k0) & mask;
+        __m256i bi = _mm256_set1_epi64x(b[i]);
+        __m256i qi = _mm256_set1_epi64x(q);
+        for (size_t j = 0; j < L; j += 4) {
+            __m256i t = _mm256_loadu_si256((const __m256i*)(acc + i + j));
+            __m256i va = _mm256_loadu_si256((const __m256i*)(a + j));
+            __m256i vm = _mm256_loadu_si256((const __m256i*)(m + j));
+            t = _mm256_add_epi64(t, _mm256_mul_epu32(va, bi));
+            t = _mm256_add_epi64(t, _mm256_mul_epu32(vm, qi));
+            _mm256_storeu_si256((__m256i*)(acc + i + j), t);
+        }
+        acc[i + 1] += acc[i] >> 26;  // acc[i] is now a multiple of 2^26
+    }
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+static void montMulIfma(uint64_t* acc, const uint64_t* a, const uint64_t* b, const uint64_t* m,
+                        uint64_t k0, size_t L) {
+    /*
+    Desc: Radix 2^52 Montgomery product kernel using the 52-bit multiply-add instructions.
+            Row i adds the low halves of a * b[i] and q * m into acc[i, i + L) and the high
+            halves, which weigh one limb more, into acc[i + 1, i + L + 1).
+    */
+    const uint64_t mask = (1ULL << 52) - 1;
+    for (size_t i = 0; i < L; i++) {
+        uint64_t lo = (uint64_t)(((unsigned __int128)a[0] * b[i]) & mask);
+        uint64_t q = ((acc[i] + lo) * k0) & mask;
+        __m512i bi = _mm512_set1_epi64(b[i]);
+        __m512i qi = _mm512_set1_epi64(q);
+        for (size_t j = 0; j < L; j += 8) {
+            __m512i t = _mm512_loadu_si512(acc + i + j);
+            __m512i va = _mm512_loadu_si512(a + j);
+            __m512i vm = _mm512_loadu_si512(m + j);
+            t = _mm512_madd52lo_epu64(t, va, bi);
+            t = _mm512_madd52lo_epu64(t, vm, qi);
+            _mm512_storeu_si512(acc + i + j, t);
+        }
+        acc[i + 1] += acc[i] >> 52;  // acc[i] is now a multiple of 2^52
+        for (size_t j = 0; j < L; j += 8) {
+            __m512i t = _mm512_loadu_si512(acc + i + 1 + j);
+            __m512i va = _mm512_loadu_si512(a + j);
+            __m512i vm = _mm512_loadu_si512(m + j);
+            t = _mm512_madd52hi_epu64(t, va, bi);
+            t = _mm512_madd52hi_epu64(t, vm, qi);
+            _mm512_storeu_si512(acc + i + 1 + j, t);
+        }
+    }
+}
+#endif
+
+size_t simdMinBits(MulKernel kernel) {
+    // Smallest modulus, in bits, for which a kernel beats the scalar squaring path (see p2 --bench).
+    if (kernel == KERNEL_AVX512_IFMA) return SIMD_MIN_BITS_IFMA;
+    if (kernel == KERNEL_AVX2) return SIMD_MIN_BITS_AVX2;
+    return SIZE_MAX;
+}
+
+size_t simdMaxBits(MulKernel kernel) {
+    // Widest modulus, in bits, a kernel handles: L limbs hold a modulus plus its spare bit.
+    if (kernel == KERNEL_AVX512_IFMA) return SIMD_MAX_LIMBS_IFMA * 52 - 1;
+    if (kernel == KERNEL_AVX2) return SIMD_MAX_LIMBS_AVX2 * 26 - 1;
+    return 0;
+}
+
+// Montgomery arithmetic with a vector kernel, with R = 2^(radix_bits * L). Same interface
+// as MontgomeryContext; numbers in Montgomery form are L small limbs.
+class SimdMontgomery {
+public:
+    typedef LimbVector Element; // Numbers in Montgomery form, one small limb per element
+
+    MulKernel kernel;      // Vector kernel doing the multiplies
+    unsigned radix_bits;   // Bits per limb (26 or 52)
+    size_t lanes;          // Limbs per vector (4 or 8)
+    size_t size;           // Number of limbs L, a multiple of lanes
+    BigInt modulus;        // The odd modulus n
+    LimbVector m;          // n in small limbs
+    uint64_t k0;           // -n^(-1) mod 2^radix_bits
+    Element r2;            // R^2 mod n
+    Element one;           // R mod n, i.e. 1 in Montgomery form
+
+    SimdMontgomery(const BigInt& n, MulKernel Kernel) {
+        /*
+        Desc: Precomputes the constants for modulus n and the given vector kernel.
+        Parameters:
+            n (const BigInt&): Odd modulus greater than 1.
+            Kernel (MulKernel): KERNEL_AVX2 or KERNEL_AVX512_IFMA; must be supported by the CPU,
+                and n at most simdMaxBits(Kernel) wide.
+        */
+        if (!n.isOdd() || n <= BigInt(1)) throw domain_error("Montgomery modulus must be odd and > 1");
+        if (n.bitLength() > simdMaxBits(Kernel)) throw domain_error("modulus too wide for the vector kernel");
+        kernel = Kernel;
+        radix_bits = kernel == KERNEL_AVX512_IFMA ? 52 : 26;
+        lanes = kernel == KERNEL_AVX512_IFMA ? 8 : 4;
+        modulus = n;
+        // One spare bit keeps every result below 2n < R, so a single subtraction reduces it.
+        size = (n.bitLength() + 1 + radix_bits - 1) / radix_bits;
+        size = (size + lanes - 1) / lanes * lanes;
+        m = toRadix(n);
+
+        uint64_t inv = n.low();
+        for (int i = 0; i < 5; i++) inv *= 2 - n.low() * inv;
+        k0 = (0 - inv) & ((1ULL << radix_bits) - 1);
+
+        r2 = toRadix((BigInt(1) << (2 * radix_bits * size)) % n);
+        one = toRadix((BigInt(1) << (radix_bits * size)) % n);
+    }
+
+    static int windowSize(size_t bits) { return MontgomeryContext::windowSize(bits); }
+
+    LimbVector toRadix(const BigInt& a) const {
+        // Splits a number below R into L limbs of radix_bits bits.
+        LimbVector out;
+        out.resize(size);
+        uint64_t mask = (1ULL << radix_bits) - 1;
+        for (size_t j = 0; j < size; j++) {
+            size_t bit = j * radix_bits;
+            size_t word = bit / 64, shift = bit % 64;
+            if (word >= a.limbs.size()) break;
+            uint64_t v = a.limbs[word] >> shift;
+            if (shift + radix_bits > 64 && word + 1 < a.limbs.size()) v |= a.limbs[word + 1] << (64 - shift);
+            out[j] = v & mask;
+        }
+        return out;
+    }
+
+    BigInt fromRadix(const LimbVector& a) const {
+        // Joins L small limbs back into a BigInt.
+        BigInt out;
+        out.limbs.resize((size * radix_bits + 63) / 64 + 1);
+        for (size_t j = 0; j < size; j++) {
+            size_t bit = j * radix_bits;
+            size_t word = bit / 64, shift = bit % 64;
+            out.limbs[word] |= a[j] << shift;
+            if (shift + radix_bits > 64) out.limbs[word + 1] |= a[j] >> (64 - shift);
+        }
+        out.normalize();
+        return out;
+    }
+
+    Element toMontgomery(const BigInt& a) const {
+        Element out = toRadix(a % modulus);
+        mul(out.data(), out.data(), r2.data());
+        return out;
+    }
+
+    BigInt fromMontgomery(const Element& a) const {
+        Element unit = toRadix(BigInt(1));
+        Element out = a;
+        mul(out.data(), a.data(), unit.data());
+        return fromRadix(out);
+    }
+
+    void mul(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        /*
+        Desc: Montgomery product out = a * b * R^(-1) mod n with the vector kernel.
+        Parameters:
+            out (uint64_t*): L limbs receiving the product; may alias a or b.
+            a, b (const uint64_t*): L limbs each, both less than n.
+        */
+        uint64_t stack_acc[2 * LimbVector::INLINE_LIMBS + 8];
+        ScratchArena::Frame frame;
+        uint64_t* acc = 2 * size + 8 > sizeof(stack_acc) / sizeof(uint64_t) ? frame.alloc(2 * size + 8) : stack_acc;
+        memset(acc, 0, (2 * size + 8) * sizeof(uint64_t));
+#if defined(__x86_64__) && defined(__GNUC__)
+        if (kernel == KERNEL_AVX512_IFMA) montMulIfma(acc, a, b, m.data(), k0, size);
+        else montMulAvx2(acc, a, b, m.data(), k0, size);
+#endif
+        // Resolve the carries left in the lanes; the result is below 2n.
+        uint64_t mask = (1ULL << radix_bits) - 1, carry = 0;
+        for (size_t j = 0; j < size; j++) {
+            uint64_t v = acc[size + j] + carry;
+            out[j] = v & mask;
+            carry = v >> radix_bits;
+        }
+        if (!lessThanModulus(out)) subLimbs(out, out, m.data());
+    }
+
+    bool lessThanModulus(const uint64_t* a) const {
+        // Whether an L-limb number is below n.
+        for (size_t j = size; j-- > 0;) {
+            if (a[j] != m[j]) return a[j] < m[j];
+        }
+        return false;
+    }
+
+    uint64_t subLimbs(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a - b over L small limbs; returns the borrow out.
+        uint64_t mask = (1ULL << radix_bits) - 1, borrow = 0;
+        for (size_t j = 0; j < size; j++) {
+            uint64_t v = a[j] - b[j] - borrow;
+            borrow = v >> 63;  // Limbs are far below 2^63, so a wrap shows in the top bit
+            out[j] = v & mask;
+        }
+        return borrow;
+    }
+
+    void addLimbs(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a + b over L small limbs. Used on sums below R, so nothing carries out.
+        uint64_t mask = (1ULL << radix_bits) - 1, carry = 0;
+        for (size_t j = 0; j < size; j++) {
+            uint64_t v = a[j] + b[j] + carry;
+            out[j] = v & mask;
+            carry = v >> radix_bits;
+        }
+    }
+
+    void add(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a + b mod n; a + b < 2n fits below R thanks to the spare bit.
+        addLimbs(out, a, b);
+        if (!lessThanModulus(out)) subLimbs(out, out, m.data());
+    }
+
+    void sub(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // out = a - b mod n.
+        if (subLimbs(out, a, b)) addLimbs(out, out, m.data());
+    }
+
+    void half(uint64_t* out, const uint64_t* a) const {
+        // out = a / 2 mod n: an odd a is made even first by adding the odd modulus.
+        if (a[0] & 1) addLimbs(out, a, m.data());
+        else if (out != a) memcpy(out, a, size * sizeof(uint64_t));
+        for (size_t j = 0; j < size; j++) {
+            uint64_t next = j + 1 < size ? out[j + 1] & 1 : 0;
+            out[j] = (out[j] >> 1) | (next << (radix_bits - 1));
+        }
+    }
+
+    void sqr(uint64_t* out, const uint64_t* a) const {
+        // Montgomery square; the vector kernel has no separate squaring schedule.
+        mul(out, a, a);
+    }
+
+    Element powerMontgomery(const Element& base, const BigInt& exp) const {
+        return slidingWindowPower(*this, base, exp);
+    }
+
+    Element powerBinary(const Element& base, const BigInt& exp) const {
+        Element result = one;
+        for (size_t i = exp.bitLength(); i-- > 0;) {
+            sqr(result.data(), result.data());
+            if (exp.bit(i)) mul(result.data(), result.data(), base.data());
+        }
+        return result;
+    }
+
+    BigInt power(const BigInt& base, const BigInt& exp) const {
+        // Computes (base^exp) % n.
+        return fromMontgomery(powerMontgomery(toMontgomery(base), exp));
+    }
+};
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("avx512f,avx512ifma")))
+static void montMulIfmaLanes(uint64_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* m,
+                             uint64_t k0, size_t L, uint64_t* acc) {
+    /*
+    Desc: Eight independent radix 2^52 Montgomery products, one per 64-bit lane. Limb j of
+            lane l is stored at j * 8 + l. acc needs (2L + 2) * 8 zeroed limbs of scratch.
+    */
+    const __m512i mask = _mm512_set1_epi64((1LL << 52) - 1);
+    const __m512i k0v = _mm512_set1_epi64(k0);
+    const __m512i zero = _mm512_setzero_si512();
+    for (size_t i = 0; i < L; i++) {
+        __m512i bi = _mm512_loadu_si512(b + 8 * i);
+        __m512i t0 = _mm512_madd52lo_epu64(_mm512_loadu_si512(acc + 8 * i), _mm512_loadu_si512(a), bi);
+        __m512i q = _mm512_madd52lo_epu64(zero, t0, k0v);
+        for (size_t j = 0; j < L; j++) {
+            __m512i t = _mm512_loadu_si512(acc + 8 * (i + j));
+            t = _mm512_madd52lo_epu64(t, _mm512_loadu_si512(a + 8 * j), bi);
+            t = _mm512_madd52lo_epu64(t, _mm512_set1_epi64(m[j]), q);
+            _mm512_storeu_si512(acc + 8 * (i + j), t);
+        }
+        __m512i carry = _mm512_maskz_srli_epi64(0xFF, _mm512_loadu_si512(acc + 8 * i), 52);  // maskz: GCC 12 warns on the plain form
+        for (size_t j = 0; j < L; j++) {
+            // High halves weigh one limb more
+            __m512i t = _mm512_loadu_si512(acc + 8 * (i + j + 1));
+            if (j == 0) t = _mm512_add_epi64(t, carry);
+            t = _mm512_madd52hi_epu64(t, _mm512_loadu_si512(a + 8 * j), bi);
+            t = _mm512_madd52hi_epu64(t, _mm512_set1_epi64(m[j]), q);
+            _mm512_storeu_si512(acc + 8 * (i + j + 1), t);
+        }
+    }
+
+    // Resolve the carries, then subtract n in the lanes whose result is not below it.
+    __m512i carry = zero, borrow = zero;
+    for (size_t j = 0; j < L; j++) {
+        __m512i v = _mm512_add_epi64(_mm512_loadu_si512(acc + 8 * (L + j)), carry);
+        carry = _mm512_maskz_srli_epi64(0xFF, v, 52);
+        v = _mm512_and_si512(v, mask);
+        _mm512_storeu_si512(out + 8 * j, v);
+        __m512i diff = _mm512_sub_epi64(_mm512_sub_epi64(v, _mm512_set1_epi64(m[j])), borrow);
+        borrow = _mm512_maskz_srli_epi64(0xFF, diff, 63);
+        _mm512_storeu_si512(acc + 8 * j, _mm512_and_si512(diff, mask));
+    }
+    __mmask8 take = _mm512_cmpeq_epi64_mask(borrow, zero);  // Lanes not below n
+    for (size_t j = 0; j < L; j++) {
+        __m512i v = _mm512_loadu_si512(out + 8 * j);
+        _mm512_storeu_si512(out + 8 * j, _mm512_mask_blend_epi64(take, v, _mm512_loadu_si512(acc + 8 * j)));
+    }
+}
+#endif
+
+// Montgomery arithmetic on a batch of eight numbers modulo the same n, one per AVX-512 IFMA
+// lane. A batch is one Element, so the exponent scan and the constants are shared while every
+// multiply advances all lanes at once. (Four AVX2 lanes of 26-bit limbs lost to running the
+// rounds one after another, so there is no AVX2 variant.)
+class BatchMontgomery {
+public:
+    typedef LimbVector Element; // L * lanes small limbs; limb j of lane l at j * lanes + l
+
+    unsigned radix_bits;   // Bits per limb (52)
+    size_t lanes;          // Numbers per batch (8)
+    size_t limbs;          // Small limbs L per number
+    size_t size;           // Limbs per batch, L * lanes
+    SimdMontgomery single; // Same modulus and radix, used for the constants and conversions
+    LimbVector m;          // n in small limbs
+    Element one;           // 1 in Montgomery form, in every lane
+
+    BatchMontgomery(const BigInt& n) : single(n, KERNEL_AVX512_IFMA) {
+        radix_bits = single.radix_bits;
+        lanes = single.lanes;
+        limbs = (n.bitLength() + 1 + radix_bits - 1) / radix_bits;
+        size = limbs * lanes;
+        // Vertical lanes need no padding, so R = 2^(radix_bits * L) may be smaller than single's.
+        single.size = limbs;
+        single.m = single.toRadix(n);
+        single.r2 = single.toRadix((BigInt(1) << (2 * radix_bits * limbs)) % n);
+        single.one = single.toRadix((BigInt(1) << (radix_bits * limbs)) % n);
+        m = single.m;
+        one = broadcast(single.one);
+    }
+
+    static int windowSize(size_t bits) { return MontgomeryContext::windowSize(bits); }
+
+    Element broadcast(const LimbVector& x) const {
+        // A batch holding the same L-limb number in every lane.
+        Element out;
+        out.resize(size);
+        for (size_t j = 0; j < limbs; j++) {
+            for (size_t l = 0; l < lanes; l++) out[j * lanes + l] = x[j];
+        }
+        return out;
+    }
+
+    Element toMontgomery(const vector<BigInt>& values) const {
+        // Converts up to `lanes` numbers into one batch in Montgomery form; missing lanes get 1.
+        Element out;
+        out.resize(size);
+        for (size_t l = 0; l < lanes; l++) {
+            LimbVector x = single.toRadix((l < values.size() ? values[l] : BigInt(1)) % single.modulus);
+            for (size_t j = 0; j < limbs; j++) out[j * lanes + l] = x[j];
+        }
+        Element r2 = broadcast(single.r2);
+        mul(out.data(), out.data(), r2.data());
+        return out;
+    }
+
+    bool laneEquals(const Element& a, size_t lane, const Element& b) const {
+        // Whether lane `lane` of a equals the same lane of b.
+        for (size_t j = 0; j < limbs; j++) {
+            if (a[j * lanes + lane] != b[j * lanes + lane]) return false;
+        }
+        return true;
+    }
+
+    void mul(uint64_t* out, const uint64_t* a, const uint64_t* b) const {
+        // Lane-wise Montgomery product of two batches; out may alias a or b.
+        ScratchArena::Frame frame;
+        uint64_t* acc = frame.alloc((2 * limbs + 2) * lanes);
+        memset(acc, 0, (2 * limbs + 2) * lanes * sizeof(uint64_t));
+#if defined(__x86_64__) && defined(__GNUC__)
+        montMulIfmaLanes(out, a, b, m.data(), single.k0, limbs, acc);
+#endif
+    }
+
+    void sqr(uint64_t* out, const uint64_t* a) const {
+        mul(out, a, a);
+    }
+
+    Element powerBinary(const Element& base, const BigInt& exp) const {
+        Element result = one;
+        for (size_t i = exp.bitLength(); i-- > 0;) {
+            sqr(result.data(), result.data());
+            if (exp.bit(i)) mul(result.data(), result.data(), base.data());
+        }
+        return result;
+    }
+};
+
+// A pool of worker threads that splits an index range into chunks. Each worker owns a deque of
+// chunks; it takes work from the back of its own deque, and once that is empty it steals from
+// the front of the others. Uneven chunks (a prime costs k rounds, most composites one) even out.
+class WorkStealingPool {
+public:
+    unsigned workers; // Number of threads, including the calling one
+
+    explicit WorkStealingPool(unsigned threads = 0) {
+        workers = threads ? threads : max(1u, thread::hardware_concurrency());
+    }
+
+    template <class Task>
+    void run(size_t count, size_t grain, Task task) {
+        /*
+        Desc: Calls task(begin, end) over chunks of [0, count) on all workers, and returns when
+                every chunk is done. The calling thread takes part as worker 0.
+        Parameters:
+            count (size_t): Number of indices.
+            grain (size_t): Indices per chunk.
+            task (Task): Callable taking (size_t begin, size_t end).
+        */
+        grain = max<size_t>(grain, 1);
+        vector<Queue> queues(workers);
+        size_t chunks = (count + grain - 1) / grain;
+        for (size_t c = 0; c < chunks; c++) {
+            // Contiguous blocks of chunks per worker, so neighbours stay on one thread
+            queues[c * workers / chunks].chunks.push_back({c * grain, min(count, (c + 1) * grain)});
+        }
+
+        auto work = [&](unsigned self) {
+            pair<size_t, size_t> range;
+            while (take(queues, self, range)) task(range.first, range.second);
+        };
+        vector<thread> threads;
+        for (unsigned w = 1; w < workers; w++) threads.emplace_back(work, w);
+        work(0);
+        for (thread& th : threads) th.join();
+    }
+
+private:
+    struct alignas(64) Queue {
+        mutex lock;
+        deque<pair<size_t, size_t>> chunks;
+    };
+
+    bool take(vector<Queue>& queues, unsigned self, pair<size_t, size_t>& range) {
+        // Own work first, newest chunk first
+        {
+            lock_guard<mutex> guard(queues[self].lock);
+            if (!queues[self].chunks.empty()) {
+                range = queues[self].chunks.back();
+                queues[self].chunks.pop_back();
+                return true;
+            }
+        }
+        // Then steal the oldest chunk of another worker. No chunks are added once run() starts,
+        // so finding every queue empty means all work has been handed out.
+        for (unsigned i = 1; i < workers; i++) {
+            Queue& victim = queues[(self + i) % workers];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.chunks.empty()) {
+                range = victim.chunks.front();
+                victim.chunks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Trial division by every odd prime below a limit, run before the Miller-Rabin rounds. The primes
+// are grouped into products that fit in 64 bits (pieces of the primorial), so a single pass over
+// the limbs of a candidate gives its residue modulo every group. Each residue is then checked
+// against the primes of its group with a multiply by the prime's inverse instead of a division.
+class TrialDivisionFilter {
+public:
+    static const uint32_t DEFAULT_LIMIT = 1000; // See p2 --bench for other depths
+    static const uint32_t MAX_LIMIT = 1 << 20;  // Deepest filter p2 --prefilter accepts, 82024 primes
+
+    enum Verdict { PASSED, COMPOSITE, PRIME };
+
+    explicit TrialDivisionFilter(uint32_t limit = DEFAULT_LIMIT) {
+        setLimit(limit);
+    }
+
+    void setLimit(uint32_t new_limit) {
+        /*
+        Desc: Rebuilds the tables for the odd primes below new_limit and clears the counters.
+                Not safe while other threads are testing.
+        Parameters:
+            new_limit (uint32_t): Filter depth; 0 (or anything up to 3) disables the filter.
+        */
+        limit = new_limit;
+        primes.clear();
+        groups.clear();
+        vector<bool> composite(limit, false);
+        for (uint32_t p = 3; p < limit; p += 2) {
+            if (composite[p]) continue;
+            for (uint64_t q = (uint64_t)p * p; q < limit; q += 2 * p) composite[q] = true;
+            uint64_t inv = p; // p^(-1) mod 2^64 by Newton iteration
+            for (int i = 0; i < 5; i++) inv *= 2 - p * inv;
+            primes.push_back({p, inv, UINT64_MAX / p});
+        }
+        for (size_t i = 0; i < primes.size();) {
+            // Greedily multiply consecutive primes while the product fits in 64 bits
+            Group g = {1, i, i};
+            while (g.end < primes.size() && g.product <= UINT64_MAX / primes[g.end].p) g.product *= primes[g.end++].p;
+            groups.push_back(g);
+            i = g.end;
+        }
+        for (Counters& c : counters) {
+            c.tested = 0;
+            c.rejected = 0;
+        }
+    }
+
+    Verdict check(const BigInt& n) const {
+        /*
+        Desc: Looks for a small odd prime factor of n.
+        Parameters:
+            n (const BigInt&): Odd number greater than 3.
+        Returns:
+            Verdict: COMPOSITE if a prime below the limit divides n, PRIME if n is one of those
+                primes or below limit^2 without a factor, and PASSED otherwise.
+        */
+        if (groups.empty()) return PASSED;
+        Counters& counts = localCounters();
+        counts.tested.fetch_add(1, memory_order_relaxed);
+
+        uint64_t stack_res[64];
+        vector<uint64_t> heap_res; // Only for very deep filters
+        uint64_t* res = stack_res;
+        if (groups.size() > 64) {
+            heap_res.resize(groups.size());
+            res = heap_res.data();
+        }
+        groupResidues(n, res);
+
+        bool small = n.limbs.size() == 1;
+        for (size_t g = 0; g < groups.size(); g++) {
+            for (size_t i = groups[g].begin; i < groups[g].end; i++) {
+                // r is divisible by odd p exactly when r * p^(-1) mod 2^64 is at most (2^64 - 1) / p
+                if (res[g] * primes[i].inverse > primes[i].max_quotient) continue;
+                if (small && n.low() == primes[i].p) return PRIME;
+                counts.rejected.fetch_add(1, memory_order_relaxed);
+                return COMPOSITE;
+            }
+        }
+        if (small && n.low() / limit < limit) return PRIME; // No factor up to sqrt(n)
+        return PASSED;
+    }
+
+    void residues(const BigInt& n, vector<uint32_t>& out) const {
+        /*
+        Desc: n modulo each prime of the filter, in ascending order of the primes.
+        Parameters:
+            n (const BigInt&): The number.
+            out (vector<uint32_t>&): Receives one residue per prime.
+        */
+        vector<uint64_t> res(groups.size());
+        groupResidues(n, res.data());
+        out.resize(primes.size());
+        for (size_t g = 0; g < groups.size(); g++) {
+            for (size_t i = groups[g].begin; i < groups[g].end; i++) out[i] = res[g] % primes[i].p;
+        }
+    }
+
+    size_t primeCount() const { return primes.size(); }
+    uint32_t prime(size_t i) const { return primes[i].p; }
+
+    double rejectionRate() const {
+        // Fraction of the numbers checked so far that had a small factor.
+        uint64_t t = checked(), r = 0;
+        for (const Counters& c : counters) r += c.rejected.load(memory_order_relaxed);
+        return t ? (double)r / t : 0.0;
+    }
+
+    uint32_t depth() const { return limit; }
+
+    uint64_t checked() const {
+        uint64_t t = 0;
+        for (const Counters& c : counters) t += c.tested.load(memory_order_relaxed);
+        return t;
+    }
+
+private:
+    struct SmallPrime {
+        uint32_t p;             // The prime
+        uint64_t inverse;       // p^(-1) mod 2^64
+        uint64_t max_quotient;  // (2^64 - 1) / p
+    };
+    struct Group {
+        uint64_t product;       // Product of primes[begin, end)
+        size_t begin, end;
+    };
+
+    void groupResidues(const BigInt& n, uint64_t* res) const {
+        // n modulo every group product, from the most significant limb down.
+        memset(res, 0, groups.size() * sizeof(uint64_t));
+        for (size_t i = n.limbs.size(); i-- > 0;) {
+            uint64_t limb = n.limbs[i];
+            for (size_t g = 0; g < groups.size(); g++) {
+                res[g] = (uint64_t)((((unsigned __int128)res[g] << 64) | limb) % groups[g].product);
+            }
+        }
+    }
+
+    uint32_t limit;                     // Primes below this are tried
+    vector<SmallPrime> primes;          // Odd primes below the limit, ascending
+    vector<Group> groups;               // Consecutive primes whose product fits in 64 bits
+
+    // Statistics since the last setLimit(), kept per thread so that the threads of a batch do not
+    // fight over one cache line on every candidate. Threads past COUNTER_SLOTS share slots.
+    static const size_t COUNTER_SLOTS = 64;
+    struct alignas(64) Counters {
+        atomic<uint64_t> tested{0};    // Numbers checked
+        atomic<uint64_t> rejected{0};  // Numbers found to have a small factor
+    };
+    mutable array<Counters, COUNTER_SLOTS> counters;
+
+    Counters& localCounters() const {
+        static atomic<size_t> nextSlot{0};
+        thread_local size_t slot = nextSlot.fetch_add(1, memory_order_relaxed) % COUNTER_SLOTS;
+        return counters[slot];
+    }
+};
+
+// Primality verdicts kept across runs in a memory-mapped file: an open-addressing table with
+// linear probing, keyed by a 128-bit hash of the limbs. A writer claims a slot with a
+// compare-and-swap on the key and publishes the entry with a release store, so any number of
+// threads or processes can read while others insert, and a reader never sees half an entry.
+class PrimalityCache {
+public:
+    static const uint64_t DEFAULT_SLOTS = 1 << 20; // 24 MB of slots
+    static const size_t MAX_PROBE = 64;            // A longer run counts as a full table
+
+    struct Entry {
+        bool prime;      // The verdict
+        uint8_t test;    // LargeNumber::Test that reached it
+        uint16_t rounds; // Miller-Rabin rounds run
+    };
+
+    PrimalityCache() {}
+    PrimalityCache(const PrimalityCache&) = delete;
+    PrimalityCache& operator=(const PrimalityCache&) = delete;
+
+    ~PrimalityCache() {
+        if (table) munmap(header, bytes);
+    }
+
+    void open(const string& path, uint64_t slots = DEFAULT_SLOTS) {
+        /*
+        Desc: Maps the cache file at path, creating an empty table of `slots` slots if the file
+                is new. An existing cache keeps its own size. The file is locked while its
+                header is checked, so processes opening it together agree on the layout.
+        Parameters:
+            path (const string&): The cache file.
+            slots (uint64_t): Table size for a new file, a power of two.
+        */
+        if (slots == 0 || (slots & (slots - 1))) throw invalid_argument("cache slots must be a power of two");
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) throw runtime_error("cannot open cache file: " + path);
+        flock(fd, LOCK_EX);
+        struct stat st;
+        Header head{};
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header)) {
+            if (pread(fd, &head, sizeof(Header), 0) != (ssize_t)sizeof(Header)) head.magic = 0;
+        }
+        bool fresh = st.st_size == 0;
+        if (fresh) {
+            head = Header{MAGIC, slots, {}};
+            if (ftruncate(fd, sizeof(Header) + slots * sizeof(Slot)) != 0 ||
+                pwrite(fd, &head, sizeof(Header), 0) != (ssize_t)sizeof(Header)) {
+                head.magic = 0;
+            }
+        }
+        // The slot count of an existing file is only trusted as a power of two small enough for
+        // the length not to wrap, and matching the file size
+        bool sane = head.slots != 0 && (head.slots & (head.slots - 1)) == 0 &&
+                    head.slots <= (SIZE_MAX - sizeof(Header)) / sizeof(Slot);
+        size_t length = sane ? sizeof(Header) + head.slots * sizeof(Slot) : 0;
+        if (head.magic != MAGIC || !sane || (!fresh && (uint64_t)st.st_size != length)) {
+            ::close(fd);
+            throw runtime_error("not a primality cache: " + path);
+        }
+        void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd); // Also drops the lock; the mapping stays valid
+        if (mapped == MAP_FAILED) throw runtime_error("cannot map cache file: " + path);
+        if (table) munmap(header, bytes);
+        header = (Header*)mapped;
+        table = (Slot*)(header + 1);
+        mask = head.slots - 1;
+        bytes = length;
+    }
+
+    bool isOpen() const { return table != nullptr; }
+
+    bool lookup(const BigInt& n, Entry& out) const {
+        /*
+        Desc: Finds the stored verdict for n.
+        Parameters:
+            n (const BigInt&): The number.
+            out (Entry&): Receives the entry when there is one.
+        Returns:
+            bool: Whether n was found.
+        */
+        uint64_t hi, lo;
+        key(n, hi, lo);
+        for (size_t i = 0; i < MAX_PROBE; i++) {
+            Slot& slot = table[(lo + i) & mask];
+            uint64_t claimed = atomic_ref<uint64_t>(slot.hi).load(memory_order_acquire);
+            if (claimed == 0) break; // End of the run: n is not in the table
+            if (claimed != hi) continue;
+            uint64_t packed = atomic_ref<uint64_t>(slot.entry).load(memory_order_acquire);
+            if (!(packed & VALID) || atomic_ref<uint64_t>(slot.lo).load(memory_order_relaxed) != lo) continue;
+            out = Entry{(packed & 1) != 0, uint8_t(packed >> 8), uint16_t(packed >> 16)};
+            hits++;
+            return true;
+        }
+        misses++;
+        return false;
+    }
+
+    void store(const BigInt& n, const Entry& entry) {
+        /*
+        Desc: Records the verdict for n, replacing any earlier one. A full run of slots, or a
+                slot another writer is still filling for the same key, drops the entry; the
+                cache only ever saves work.
+        */
+        uint64_t hi, lo;
+        key(n, hi, lo);
+        uint64_t packed = VALID | (uint64_t)entry.rounds << 16 | (uint64_t)entry.test << 8 | entry.prime;
+        for (size_t i = 0; i < MAX_PROBE; i++) {
+            Slot& slot = table[(lo + i) & mask];
+            atomic_ref<uint64_t> claim(slot.hi);
+            uint64_t claimed = claim.load(memory_order_acquire);
+            if (claimed == 0) {
+                if (claim.compare_exchange_strong(claimed, hi, memory_order_acq_rel)) {
+                    atomic_ref<uint64_t>(slot.lo).store(lo, memory_order_relaxed);
+                    atomic_ref<uint64_t>(slot.entry).store(packed, memory_order_release);
+                    return;
+                }
+                // Lost the slot to another writer; claimed now holds its key
+            }
+            if (claimed != hi) continue;
+            atomic_ref<uint64_t> current(slot.entry);
+            if (!(current.load(memory_order_acquire) & VALID)) return;
+            if (atomic_ref<uint64_t>(slot.lo).load(memory_order_relaxed) != lo) continue;
+            current.store(packed, memory_order_release);
+            return;
+        }
+    }
+
+    uint64_t hitCount() const { return hits; }
+    uint64_t missCount() const { return misses; }
+
+private:
+    static const uint64_t MAGIC = 0x31454843454d5250ULL; // "PRMECHE1"
+    static const uint64_t VALID = 1ULL << 63;            // Set once an entry is complete
+
+    struct Header {
+        uint64_t magic;
+        uint64_t slots;
+        uint64_t reserved[6]; // Keeps the slots on a cache line boundary
+    };
+    struct Slot {
+        uint64_t hi;    // High half of the key; 0 marks a free slot
+        uint64_t lo;    // Low half of the key, also the home position
+        uint64_t entry; // VALID | rounds << 16 | test << 8 | prime
+    };
+
+    static void key(const BigInt& n, uint64_t& hi, uint64_t& lo) {
+        // MurmurHash3-style 128-bit hash of the limbs, two at a time, seeded with their count.
+        const uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+        auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+        auto fmix = [](uint64_t k) {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdULL;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ULL;
+            return k ^ (k >> 33);
+        };
+        size_t count = n.limbs.size();
+        uint64_t h1 = count, h2 = count;
+        for (size_t i = 0; i < count; i += 2) {
+            uint64_t k1 = n.limbs[i], k2 = i + 1 < count ? n.limbs[i + 1] : 0;
+            h1 ^= rotl(k1 * c1, 31) * c2;
+            h1 = (rotl(h1, 27) + h2) * 5 + 0x52dce729;
+            h2 ^= rotl(k2 * c2, 33) * c1;
+            h2 = (rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+        }
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+        hi = h1 ? h1 : 1; // 0 is reserved for free slots
+        lo = h2;
+    }
+
+    Header* header = nullptr;  // Start of the mapping
+    Slot* table = nullptr;     // The slots, after the header
+    uint64_t mask = 0;         // Number of slots minus one
+    size_t bytes = 0;          // Length of the mapping
+    mutable atomic<uint64_t> hits{0};    // Lookups answered in this process
+    mutable atomic<uint64_t> misses{0};  // Lookups that found nothing
+};
+
+// LargeNumber class to handle large numbers using a multi-precision integer
+class LargeNumber {
+public:
+    BigInt value; // The number itself
+
+    // Constructor to initialize an empty LargeNumber
+    LargeNumber() {}
+
+    // Constructor parsing a decimal string
+    explicit LargeNumber(const string& digits) : value(BigInt::fromDecimal(digits)) {}
+
+    // Print the LargeNumber (from most significant to least)
+    void print() const {
+        cout << value.toString();
+    }
+
+    // Implementation of the Miller-Rabin primality test
+    bool millerRabin(int k) const {
+        /*
+        Desc: Performs the Miller-Rabin primality test on the number stored in the LargeNumber.
+        Parameters:
+            k (int): Number of iterations to perform for accuracy.
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        return millerRabin(value, k);
+    }
+
+    static bool millerRabin(const BigInt& n, int k) {
+        /*
+        Desc: Performs the Miller-Rabin primality test on a full multi-precision number.
+        Parameters:
+            n (const BigInt&): The number to test.
+            k (int): Number of iterations to perform for accuracy.
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        // Base cases for small numbers
+        if (n.limbs.size() <= 1 && n.low() <= 3) return n.low() >= 2;  // 2 and 3 are prime, 0 and 1 are not
+        if (!n.isOdd()) return false;                                     // Exclude even numbers
+
+        if (n.limbs.size() == 1) return isPrime64(n.low());  // Exact, whatever k is
+
+        // Most random candidates have a small factor and never reach a modexp
+        TrialDivisionFilter::Verdict small = prefilter().check(n);
+        if (small != TrialDivisionFilter::PASSED) return small == TrialDivisionFilter::PRIME;
+
+        // Write n-1 as 2^s * d (factoring out powers of 2 in one shift)
+        BigInt nMinus1 = n - BigInt(1);
+        size_t s = nMinus1.trailingZeros();
+        BigInt d = nMinus1 >> s;
+
+        // With IFMA, one round screens out most composites and the remaining rounds run
+        // side by side in the lanes of a batch.
+        if (activeMulKernel == KERNEL_AVX512_IFMA && k > 1 && n.bitLength() >= BATCH_MIN_BITS &&
+            n.bitLength() <= simdMaxBits(KERNEL_AVX512_IFMA)) {
+            if (!withContext(n, [&](const auto& ctx) { return millerRabinRounds(ctx, n, nMinus1, d, s, 1); })) {
+                return false;
+            }
+            return millerRabinBatched(BatchMontgomery(n), n, nMinus1, d, s, k - 1);
+        }
+
+        return withContext(n, [&](const auto& ctx) { return millerRabinRounds(ctx, n, nMinus1, d, s, k); });
+    }
+
+    static bool isPrime64(uint64_t n) {
+        /*
+        Desc: Deterministic primality test for numbers below 2^64: trial division by the primes
+                below 64, then strong probable-prime tests to a base set that no composite in
+                range passes: {2, 7, 61} below 4759123141, and otherwise the seven bases of Jim
+                Sinclair's set. Uses no random numbers.
+        Parameters:
+            n (uint64_t): The number to test.
+        Returns:
+            bool: True if n is prime, False otherwise.
+        */
+        if (n < 64) return (0x28208a20a08a28acULL >> n) & 1;  // Bit p is set for each prime p < 64
+        if (!(n & 1)) return false;
+        // Divisibility by odd p without a division: n * p^(-1) mod 2^64 is at most (2^64 - 1) / p
+        // exactly when p divides n.
+        struct Divisor { uint64_t inverse, max_quotient; };
+        static constexpr auto divisors = [] {
+            const uint64_t small_primes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61};
+            array<Divisor, 17> table{};
+            for (size_t i = 0; i < table.size(); i++) {
+                uint64_t p = small_primes[i], inv = p;
+                for (int j = 0; j < 5; j++) inv *= 2 - p * inv;
+                table[i] = {inv, UINT64_MAX / p};
+            }
+            return table;
+        }();
+        for (const Divisor& p : divisors) {
+            if (n * p.inverse <= p.max_quotient) return false;
+        }
+        if (n < 64 * 64) return true;  // No factor up to sqrt(n)
+
+        // Base 2 on its own rejects nearly every composite left; the other bases then run together.
+        Montgomery64 ctx(n);
+        if (n < 4759123141ULL) return ctx.strongProbablePrime({2, 7, 61});
+        if (!ctx.strongProbablePrime({2})) return false;
+        return ctx.strongProbablePrime({325, 9375, 28178, 450775, 9780504, 1795265022});
+    }
+
+    static TrialDivisionFilter& prefilter() {
+        // The small-prime filter shared by every test; set its depth before testing starts.
+        static TrialDivisionFilter filter;
+        return filter;
+    }
+
+    template <class Task>
+    static bool withContext(const BigInt& n, Task task) {
+        /*
+        Desc: Builds the fastest Montgomery context for an odd n and passes it to task. Wide
+                numbers use the vector kernel when the CPU has one (up to simdMaxBits(), beyond
+                which its lanes could overflow), common key sizes the
+                fixed-width path, and anything else the arbitrary-precision one. Either way the
+                Montgomery constants are computed once and shared by every round run on it.
+        Parameters:
+            n (const BigInt&): The odd modulus.
+            task (Task): Callable taking the context by const reference.
+        Returns:
+            bool: Whatever task returns.
+        */
+        if (activeMulKernel != KERNEL_SCALAR && n.bitLength() >= simdMinBits(activeMulKernel) &&
+            n.bitLength() <= simdMaxBits(activeMulKernel)) {
+            return task(SimdMontgomery(n, activeMulKernel));
+        }
+        switch (n.limbs.size()) {
+            case 8: return task(FixedMontgomery<512>(n));
+            case 16: return task(FixedMontgomery<1024>(n));
+            case 32: return task(FixedMontgomery<2048>(n));
+            case 64: return task(FixedMontgomery<4096>(n));
+            default: return task(MontgomeryContext(n));
+        }
+    }
+
+    static bool millerRabinParallel(const BigInt& n, int k, unsigned threads = 0) {
+        /*
+        Desc: Miller-Rabin for a single huge number, with the k rounds spread across threads.
+                The first thread to find a witness raises a flag that the others check between
+                squarings, so a composite returns as soon as the quickest witness is found and
+                a prime takes about ceil(k / threads) rounds of wall time.
+        Parameters:
+            n (const BigInt&): The number to test.
+            k (int): Number of iterations to perform for accuracy.
+            threads (unsigned): Worker threads; 0 uses one per hardware thread.
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        if (n.limbs.size() <= 1 && n.low() <= 3) return n.low() >= 2;
+        if (!n.isOdd()) return false;
+        if (n.limbs.size() == 1) return isPrime64(n.low());
+        TrialDivisionFilter::Verdict small = prefilter().check(n);
+        if (small != TrialDivisionFilter::PASSED) return small == TrialDivisionFilter::PRIME;
+        if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+        threads = min<unsigned>(threads, max(k, 1));
+
+        BigInt nMinus1 = n - BigInt(1);
+        size_t s = nMinus1.trailingZeros();
+        BigInt d = nMinus1 >> s;
+
+        return withContext(n, [&](const auto& ctx) {
+            atomic<int> next(0);             // Next round to hand out
+            atomic<bool> composite(false);   // Set by the first thread to find a witness
+            auto work = [&]() {
+                while (!composite.load(memory_order_relaxed) && next.fetch_add(1) < k) {
+                    if (!millerRabinRounds(ctx, n, nMinus1, d, s, 1, &composite)) composite = true;
+                }
+            };
+            vector<thread> workers;
+            for (unsigned t = 1; t < threads; t++) workers.emplace_back(work);
+            work();
+            for (thread& th : workers) th.join();
+            return !composite.load();
+        });
+    }
+
+    enum Test { MILLER_RABIN, BAILLIE_PSW }; // Primality tests to choose from
+
+    static bool isProbablePrime(const BigInt& n, Test test, int k) {
+        /*
+        Desc: Runs the chosen primality test.
+        Parameters:
+            n (const BigInt&): The number to test.
+            test (Test): MILLER_RABIN with k random bases, or BAILLIE_PSW (k is ignored).
+            k (int): Number of Miller-Rabin iterations.
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        return test == BAILLIE_PSW ? bailliePSW(n) : millerRabin(n, k);
+    }
+
+    static PrimalityCache& resultCache() {
+        // The on-disk verdict cache; open it before testing starts to turn it on.
+        static PrimalityCache cache;
+        return cache;
+    }
+
+    static bool isProbablePrimeCached(const BigInt& n, Test test, int k) {
+        /*
+        Desc: isProbablePrime() through the result cache, when one is open. A composite verdict
+                is final whichever test reached it; a probable prime is reused for the same
+                test, and for Miller-Rabin only if at least k rounds were run. Anything else is
+                tested and the new verdict stored. Numbers of one limb are decided exactly in
+                less time than a lookup and are not cached.
+        Parameters:
+            n (const BigInt&): The number to test.
+            test (Test), k (int): As for isProbablePrime().
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        PrimalityCache& cache = resultCache();
+        if (!cache.isOpen() || n.limbs.size() <= 1) return isProbablePrime(n, test, k);
+        PrimalityCache::Entry entry;
+        if (cache.lookup(n, entry) &&
+            (!entry.prime || (entry.test == test && (test == BAILLIE_PSW || entry.rounds >= k)))) {
+            return entry.prime;
+        }
+        bool prime = isProbablePrime(n, test, k);
+        cache.store(n, PrimalityCache::Entry{prime, uint8_t(test), uint16_t(min(k, 65535))});
+        return prime;
+    }
+
+    struct Result {
+        bool probably_prime; // Verdict of isProbablePrime() for the number at the same index
+    };
+
+    static vector<Result> testMany(span<const BigInt> numbers, int k, unsigned threads = 0,
+                                   Test test = MILLER_RABIN) {
+        /*
+        Desc: Runs a primality test on many numbers across a work-stealing thread pool, through
+                the result cache when one is open. Every thread draws bases from its own
+                generator (see randomBase()).
+        Parameters:
+            numbers (span<const BigInt>): The numbers to test.
+            k (int): Number of iterations per number.
+            threads (unsigned): Worker threads; 0 uses one per hardware thread.
+            test (Test): Which test to run.
+        Returns:
+            vector<Result>: One result per number, in input order.
+        */
+        vector<Result> results(numbers.size());
+        WorkStealingPool pool(threads);
+        pool.run(numbers.size(), 16, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) results[i].probably_prime = isProbablePrimeCached(numbers[i], test, k);
+        });
+        return results;
+    }
+
+    template <class Context>
+    static bool millerRabinRounds(const Context& ctx, const BigInt& n, const BigInt& nMinus1,
+                                  const BigInt& d, size_t s, int k, const atomic<bool>* cancel = nullptr) {
+        /*
+        Desc: The k rounds of Miller-Rabin, carried out in Montgomery form.
+        Parameters:
+            ctx (const Context&): Montgomery context for n (fixed-width or arbitrary-precision).
+            n (const BigInt&): The number to test, odd and at least 5.
+            nMinus1 (const BigInt&): n-1.
+            d (const BigInt&), s (size_t): n-1 = 2^s * d with d odd.
+            k (int): Number of iterations to perform for accuracy.
+            cancel (const atomic<bool>*): Optional flag checked between squarings; once it is
+                set the rounds stop and return true, leaving the verdict to whoever set it.
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        typename Context::Element minusOne = ctx.toMontgomery(nMinus1);  // n-1 in Montgomery form
+
+        // Perform Miller-Rabin test for k iterations
+        for (int i = 0; i < k; i++) {
+            BigInt a = randomBase(n);  // Random base (a) in [2, n-2]
+            if (!strongProbablePrime(ctx, minusOne, a, d, s, cancel)) return false;
+        }
+
+        // If all rounds pass, n is probably prime
+        return true;
+    }
+
+    template <class Context>
+    static bool strongProbablePrime(const Context& ctx, const typename Context::Element& minusOne,
+                                    const BigInt& a, const BigInt& d, size_t s, const atomic<bool>* cancel = nullptr) {
+        /*
+        Desc: One Miller-Rabin round: whether n is a strong probable prime to base a.
+        Parameters:
+            ctx (const Context&): Montgomery context for n.
+            minusOne (const Element&): n-1 in Montgomery form.
+            a (const BigInt&): The base.
+            d (const BigInt&), s (size_t): n-1 = 2^s * d with d odd.
+            cancel (const atomic<bool>*): As for millerRabinRounds().
+        Returns:
+            bool: False if a is a witness that n is composite.
+        */
+        typedef typename Context::Element Element;
+        Element x = slidingWindowPower(ctx, ctx.toMontgomery(a), d, cancel);  // Compute a^d % n
+        if (cancel && cancel->load(memory_order_relaxed)) return true;
+
+        // If x == 1 or x == n-1, this round passes
+        if (sameLimbs(x, ctx.one, ctx.size) || sameLimbs(x, minusOne, ctx.size)) return true;
+
+        // Perform up to s-1 squaring rounds (check for x^2, x^4, ..., until x == n-1)
+        for (size_t r = 1; r < s; r++) {
+            if (cancel && cancel->load(memory_order_relaxed)) return true;
+            ctx.sqr(x.data(), x.data());  // Compute x^2 % n
+            if (sameLimbs(x, minusOne, ctx.size)) return true;  // If x reaches n-1, the round passes
+        }
+
+        // If x never reached n-1, n is composite
+        return false;
+    }
+
+    static bool bailliePSW(const BigInt& n) {
+        /*
+        Desc: Baillie-PSW test: a strong probable-prime test to base 2 followed by a strong Lucas
+                test with Selfridge's parameters. No composite is known to pass both, and the cost
+                is about that of three Miller-Rabin rounds.
+        Parameters:
+            n (const BigInt&): The number to test.
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        if (n.limbs.size() <= 1) return isPrime64(n.low());  // Already exact
+        if (!n.isOdd()) return false;
+        TrialDivisionFilter::Verdict small = prefilter().check(n);
+        if (small != TrialDivisionFilter::PASSED) return small == TrialDivisionFilter::PRIME;
+
+        BigInt nMinus1 = n - BigInt(1);
+        size_t s = nMinus1.trailingZeros();
+        BigInt d = nMinus1 >> s;
+        bool base2 = withContext(n, [&](const auto& ctx) {
+            return strongProbablePrime(ctx, ctx.toMontgomery(nMinus1), BigInt(2), d, s);
+        });
+        if (!base2) return false;
+
+        // Selfridge: the first D in 5, -7, 9, -11, ... with (D/n) = -1. A square n has no such D.
+        if (n.isSquare()) return false;
+        int64_t D = 5;
+        while (true) {
+            BigInt Dn = D > 0 ? BigInt(D) : n - BigInt(-D);  // D mod n
+            int j = BigInt::jacobi(Dn, n);
+            if (j == -1) break;
+            if (j == 0 && BigInt(D > 0 ? D : -D) != n) return false;  // |D| is a factor of n
+            D = D > 0 ? -(D + 2) : -D + 2;
+        }
+        return withContext(n, [&](const auto& ctx) { return strongLucas(ctx, n, D); });
+    }
+
+    template <class Context>
+    static bool strongLucas(const Context& ctx, const BigInt& n, int64_t D) {
+        /*
+        Desc: Strong Lucas probable-prime test with P = 1 and Q = (1 - D) / 4. With
+                n + 1 = 2^s * d, n passes if U_d = 0 or V_(d * 2^r) = 0 for some r < s.
+                U and V are doubled along the bits of d: U_2k = U_k V_k, V_2k = V_k^2 - 2Q^k,
+                and a set bit steps to U_2k+1 = (U_2k + V_2k) / 2, V_2k+1 = (D U_2k + V_2k) / 2.
+        Parameters:
+            ctx (const Context&): Montgomery context for n, with add(), sub() and half().
+            n (const BigInt&): The number to test, odd, not a square, with (D/n) = -1.
+            D (int64_t): Selfridge's D.
+        Returns:
+            bool: True if n is a strong Lucas probable prime.
+        */
+        typedef typename Context::Element Element;
+        auto fromSmall = [&](int64_t v) {
+            // A small signed number in Montgomery form
+            BigInt mag = BigInt(v < 0 ? -v : v) % n;
+            return ctx.toMontgomery(v < 0 && !mag.isZero() ? n - mag : mag);
+        };
+        Element dm = fromSmall(D), qm = fromSmall((1 - D) / 4);
+        BigInt nPlus1 = n + BigInt(1);
+        size_t s = nPlus1.trailingZeros();
+        BigInt d = nPlus1 >> s;
+
+        Element U = ctx.one, V = ctx.one, Qk = qm, t = ctx.one;  // U_1 = 1, V_1 = P = 1, Q^1
+        for (size_t i = d.bitLength() - 1; i-- > 0;) {
+            ctx.mul(U.data(), U.data(), V.data());
+            ctx.sqr(V.data(), V.data());
+            ctx.sub(V.data(), V.data(), Qk.data());
+            ctx.sub(V.data(), V.data(), Qk.data());
+            ctx.sqr(Qk.data(), Qk.data());
+            if (d.bit(i)) {
+                ctx.mul(t.data(), dm.data(), U.data());
+                ctx.add(U.data(), U.data(), V.data());
+                ctx.half(U.data(), U.data());
+                ctx.add(V.data(), V.data(), t.data());
+                ctx.half(V.data(), V.data());
+                ctx.mul(Qk.data(), Qk.data(), qm.data());
+            }
+        }
+
+        if (isZeroElement(U, ctx.size) || isZeroElement(V, ctx.size)) return true;
+        for (size_t r = 1; r < s; r++) {
+            // V_2k = V_k^2 - 2Q^k
+            ctx.sqr(V.data(), V.data());
+            ctx.sub(V.data(), V.data(), Qk.data());
+            ctx.sub(V.data(), V.data(), Qk.data());
+            if (isZeroElement(V, ctx.size)) return true;
+            ctx.sqr(Qk.data(), Qk.data());
+        }
+        return false;
+    }
+
+    template <class Element>
+    static bool isZeroElement(const Element& a, size_t limbs) {
+        // Zero is zero in Montgomery form too.
+        for (size_t j = 0; j < limbs; j++) {
+            if (a.data()[j]) return false;
+        }
+        return true;
+    }
+
+    static bool millerRabinBatched(const BatchMontgomery& ctx, const BigInt& n, const BigInt& nMinus1,
+                                   const BigInt& d, size_t s, int k) {
+        /*
+        Desc: k rounds of Miller-Rabin, evaluated a batch of `lanes` bases at a time. All rounds
+                raise their base to the same d modulo the same n, so one exponent scan drives
+                every lane, and the squaring loop continues while any lane is undecided.
+        Parameters:
+            ctx (const BatchMontgomery&): Batch Montgomery context for n.
+            n, nMinus1, d, s, k: As for millerRabinRounds().
+        Returns:
+            bool: True if the number is probably prime, False if composite.
+        */
+        BatchMontgomery::Element minusOne = ctx.toMontgomery(vector<BigInt>(ctx.lanes, nMinus1));
+
+        for (int done = 0; done < k; done += ctx.lanes) {
+            size_t count = min((size_t)(k - done), ctx.lanes);
+            vector<BigInt> bases;
+            for (size_t l = 0; l < count; l++) bases.push_back(randomBase(n));  // Random bases in [2, n-2]
+            BatchMontgomery::Element x = slidingWindowPower(ctx, ctx.toMontgomery(bases), d);
+
+            // A lane passes once it reaches 1 at the start or n-1 at any point
+            vector<bool> pending(count);
+            size_t open = 0;
+            for (size_t l = 0; l < count; l++) {
+                pending[l] = !ctx.laneEquals(x, l, ctx.one) && !ctx.laneEquals(x, l, minusOne);
+                if (pending[l]) open++;
+            }
+            for (size_t r = 1; r < s && open > 0; r++) {
+                ctx.sqr(x.data(), x.data());
+                for (size_t l = 0; l < count; l++) {
+                    if (pending[l] && ctx.laneEquals(x, l, minusOne)) {
+                        pending[l] = false;
+                        open--;
+                    }
+                }
+            }
+
+            // Any lane that never reached n-1 is a witness that n is composite
+            if (open > 0) return false;
+        }
+        return true;
+    }
+
+    template <class Element>
+    static bool sameLimbs(const Element& a, const Element& b, size_t limbs) {
+        // Compares two numbers in Montgomery form, which always have the same number of limbs.
+        return memcmp(a.data(), b.data(), limbs * sizeof(uint64_t)) == 0;
+    }
+
+    static BigInt randomBase(const BigInt& n) {
+        /*
+        Desc: Draws a uniformly random base in [2, n-2] for n >= 5, by rejection sampling
+                numbers of the same bit length as n-3.
+        Parameters:
+            n (const BigInt&): The number under test.
+        Returns:
+            BigInt: The random base.
+        */
+        thread_local mt19937_64 gen(random_device{}());  // Seeded once per thread
+        BigInt span = n - BigInt(3);  // Number of choices minus one
+        size_t bits = span.bitLength();
+        BigInt a;
+        do {
+            a.limbs.resize((bits + 63) / 64);
+            for (size_t j = 0; j < a.limbs.size(); j++) a.limbs[j] = gen();
+            if (bits % 64) a.limbs[a.limbs.size() - 1] &= (1ULL << (bits % 64)) - 1;
+            a.normalize();
+        } while (a > span);
+        return a + BigInt(2);
+    }
+
+    // Power function (Exponentiation by Squaring), in Montgomery form for odd moduli
+    static BigInt power(const BigInt& base, const BigInt& exp, const BigInt& mod) {
+        /*
+        Desc: Computes (base^exp) % mod. Odd moduli use Montgomery multiplication; even ones
+                Barrett reduction, or division-based reduction below BARRETT_MIN_LIMBS.
+        Parameters:
+            base (const BigInt&): Base of the exponentiation.
+            exp (const BigInt&): Exponent.
+            mod (const BigInt&): Modulus.
+        Returns:
+            BigInt: Result of (base^exp) % mod.
+        */
+        if (mod.isOdd() && mod > BigInt(1)) return MontgomeryContext(mod).power(base, exp);
+        if (mod.limbs.size() >= BARRETT_MIN_LIMBS) return BarrettContext(mod).power(base, exp);
+        return powerByDivision(base, exp, mod);
+    }
+
+    static BigInt powerByDivision(BigInt base, const BigInt& exp, const BigInt& mod) {
+        /*
+        Desc: Computes (base^exp) % mod using Exponentiation by Squaring, reducing each
+                product with a long division.
+        Parameters:
+            base (BigInt): Base of the exponentiation.
+            exp (const BigInt&): Exponent.
+            mod (const BigInt&): Modulus.
+        Returns:
+            BigInt: Result of (base^exp) % mod.
+        */
+        BigInt result = BigInt(1) % mod;  // Initialize result to 1
+        base = base % mod;                // Mod the base to reduce its size
+
+        size_t bits = exp.bitLength();
+        for (size_t i = 0; i < bits; i++) {
+            // If the current bit of the exponent is set, multiply base with result
+            if (exp.bit(i)) {
+                result = (result * base) % mod;
+            }
+            if (i + 1 < bits) base = BigInt::square(base) % mod;  // Square the base and mod it
+        }
+
+        return result;  // Return the final result
+    }
+};
+
+BigInt randomOddNumber(size_t bits, mt19937_64& gen) {
+    /*
+    Desc: Draws a random odd number with exactly the given number of bits.
+    Parameters:
+        bits (size_t): Bit length of the number (at least 2).
+        gen (mt19937_64&): Random number generator.
+    Returns:
+        BigInt: The random number.
+    */
+    BigInt n;
+    n.limbs.resize((bits + 63) / 64);
+    for (size_t i = 0; i < n.limbs.size(); i++) n.limbs[i] = gen();
+    size_t top = (bits - 1) % 64;
+    n.limbs[n.limbs.size() - 1] &= (top == 63) ? ~0ULL : (1ULL << (top + 1)) - 1;
+    n.limbs[n.limbs.size() - 1] |= 1ULL << top;  // Force the bit length
+    n.limbs[0] |= 1;                             // Force the number odd
+    return n;
+}
+
+// Sieve settings for nextPrime(): candidates are struck out by the odd primes below
+// SIEVE_PRIME_LIMIT, SIEVE_WINDOW odd candidates at a time.
+const uint32_t SIEVE_PRIME_LIMIT = 1 << 16;
+const size_t SIEVE_WINDOW = 4096;
+
+BigInt nextPrime(const BigInt& start, int k = 10, LargeNumber::Test test = LargeNumber::MILLER_RABIN) {
+    /*
+    Desc: Finds the smallest probable prime greater than start. Odd candidates are sieved a
+            window at a time, and only the survivors get the full primality test. Each sieving
+            prime's residue is computed once; after that the offset of its next multiple is
+            carried from window to window instead of being recomputed from the BigInt.
+    Parameters:
+        start (const BigInt&): Where to start searching.
+        k (int): Number of Miller-Rabin iterations for the survivors.
+        test (LargeNumber::Test): Which test the survivors get.
+    Returns:
+        BigInt: The next probable prime after start.
+    */
+    if (start < BigInt(2)) return BigInt(2);
+    BigInt n = start + BigInt(1);
+    if (!n.isOdd()) n += BigInt(1);
+    while (n.limbs.size() == 1) {
+        // Below 2^64 the exact test is cheaper than setting up the sieve
+        if (LargeNumber::isPrime64(n.low())) return n;
+        n += BigInt(2);
+    }
+
+    static const TrialDivisionFilter sieve_primes(SIEVE_PRIME_LIMIT);
+    size_t count = sieve_primes.primeCount();
+    vector<uint32_t> next; // Per prime: offset of the next odd multiple, from the window start
+    sieve_primes.residues(n, next);
+    for (size_t i = 0; i < count; i++) {
+        // Solve n + 2j = 0 mod p for j, using 2^(-1) = (p + 1) / 2
+        uint64_t p = sieve_primes.prime(i), r = next[i];
+        next[i] = (uint32_t)((p - r) % p * ((p + 1) / 2) % p);
+    }
+
+    vector<uint8_t> struck(SIEVE_WINDOW);
+    for (BigInt base = n;; base += BigInt(2 * SIEVE_WINDOW)) {
+        fill(struck.begin(), struck.end(), 0);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t p = sieve_primes.prime(i);
+            size_t j = next[i];
+            for (; j < SIEVE_WINDOW; j += p) struck[j] = 1;
+            next[i] = (uint32_t)(j - SIEVE_WINDOW);
+        }
+        for (size_t j = 0; j < SIEVE_WINDOW; j++) {
+            if (struck[j]) continue;
+            BigInt candidate = base + BigInt(2 * j);
+            if (LargeNumber::isProbablePrime(candidate, test, k)) return candidate;
+        }
+    }
+}
+
+BigInt randomPrime(size_t bits, int k = 10, LargeNumber::Test test = LargeNumber::MILLER_RABIN) {
+    /*
+    Desc: Draws a random probable prime of exactly the given number of bits: the first prime
+            at or after a random odd starting point, retried if it runs past the bit length.
+    Parameters:
+        bits (size_t): Bit length of the prime (at least 2).
+        k (int), test (LargeNumber::Test): As for nextPrime().
+    Returns:
+        BigInt: The random prime.
+    */
+    if (bits < 2) throw domain_error("a prime needs at least 2 bits");
+    thread_local mt19937_64 gen(random_device{}());  // Seeded once per thread
+    while (true) {
+        BigInt p = nextPrime(randomOddNumber(bits, gen) - BigInt(1), k, test);
+        if (p.bitLength() == bits) return p;
+    }
+}
+
+// Segmented sieve of Eratosthenes for enumerating and counting the primes in a range. Only
+// numbers coprime to 30 are stored: one byte holds the 8 of every 30 numbers, one bit each.
+// The range is cut into chunks handed to a thread pool. A chunk is sieved one segment at a time,
+// with each segment small enough to stay in the cache. Primes that reach a segment at most once
+// are kept in buckets, one per upcoming segment, so a segment only visits the primes that
+// actually cross it.
+class SegmentedSieve {
+public:
+    static const size_t SEGMENT_BYTES = 32 * 1024;  // One L1 data cache, 983040 numbers
+    static const size_t CHUNK_SEGMENTS = 64;        // Segments per chunk of work
+
+    explicit SegmentedSieve(unsigned threads = 0, size_t segment_bytes = SEGMENT_BYTES) : pool(threads) {
+        segment = segment_bytes;
+    }
+
+    uint64_t count(uint64_t lo, uint64_t hi) {
+        /*
+        Desc: Counts the primes in [lo, hi), with the chunks spread over the thread pool.
+        Parameters:
+            lo (uint64_t), hi (uint64_t): The range.
+        Returns:
+            uint64_t: Number of primes in the range.
+        */
+        uint64_t total = smallPrimes(lo, hi, [](uint64_t) {});
+        Plan plan = prepare(lo, hi);
+        atomic<uint64_t> found(0);
+        pool.run(plan.chunks, 1, [&](size_t begin, size_t end) {
+            vector<uint8_t> buffer(plan.chunk_bytes);
+            for (size_t c = begin; c < end; c++) {
+                size_t bytes = sieveChunk(plan, c, buffer.data());
+                uint64_t chunk_count = 0;
+                for (size_t i = 0; i < bytes; i++) chunk_count += __builtin_popcount(buffer[i]);
+                found.fetch_add(chunk_count, memory_order_relaxed);
+            }
+        });
+        return total + found.load();
+    }
+
+    template <class Callback>
+    void forEach(uint64_t lo, uint64_t hi, Callback callback) {
+        /*
+        Desc: Calls callback(p) for every prime p in [lo, hi), in ascending order, from the
+                calling thread. The workers sieve one chunk each per round into their own buffer,
+                and the primes of a round are streamed out before the next round starts, so
+                memory stays at one chunk per thread.
+        Parameters:
+            lo (uint64_t), hi (uint64_t): The range.
+            callback (Callback): Callable taking a uint64_t.
+        */
+        smallPrimes(lo, hi, callback);
+        Plan plan = prepare(lo, hi);
+        vector<vector<uint8_t>> buffers(pool.workers, vector<uint8_t>(plan.chunk_bytes));
+        vector<size_t> used(pool.workers);
+        for (size_t first = 0; first < plan.chunks; first += pool.workers) {
+            size_t round = min<size_t>(pool.workers, plan.chunks - first);
+            pool.run(round, 1, [&](size_t begin, size_t end) {
+                for (size_t c = begin; c < end; c++) used[c] = sieveChunk(plan, first + c, buffers[c].data());
+            });
+            for (size_t c = 0; c < round; c++) {
+                uint64_t base = plan.base + (first + c) * plan.chunk_bytes * 30;
+                const uint8_t* bits = buffers[c].data();
+                for (size_t i = 0; i < used[c]; i++) {
+                    for (uint8_t b = bits[i]; b; b &= b - 1) callback(base + i * 30 + WHEEL[__builtin_ctz(b)]);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr uint8_t WHEEL[8] = {1, 7, 11, 13, 17, 19, 23, 29};  // Residues mod 30 kept
+    static constexpr uint8_t STEP[8] = {6, 4, 2, 4, 2, 4, 6, 2};         // From each residue to the next
+    static constexpr auto BIT = [] {
+        // Bit of each residue mod 30 within its byte (8 for residues sharing a factor with 30)
+        array<uint8_t, 30> bit{};
+        for (int r = 0; r < 30; r++) bit[r] = 8;
+        for (int i = 0; i < 8; i++) bit[WHEEL[i]] = i;
+        return bit;
+    }();
+
+    struct Plan {
+        uint64_t lo, hi;             // The range, less the primes 2, 3 and 5
+        uint64_t base;               // lo rounded down to a multiple of 30
+        size_t chunk_bytes;          // Bytes per chunk, CHUNK_SEGMENTS segments
+        size_t chunks;               // Number of chunks covering [base, hi)
+        vector<uint32_t> primes;     // Sieving primes from 7 up to sqrt(hi)
+    };
+
+    struct Crossing {
+        uint64_t next;               // Next odd multiple to strike, coprime to 30
+        uint32_t prime;
+        uint32_t wheel;              // Index in WHEEL of the cofactor of next
+    };
+
+    WorkStealingPool pool;
+    size_t segment;                  // Bytes per segment
+
+    template <class Callback>
+    static uint64_t smallPrimes(uint64_t lo, uint64_t hi, Callback&& callback) {
+        // The wheel leaves out 2, 3 and 5; reports those in range and returns how many there were.
+        uint64_t found = 0;
+        for (uint64_t p : {2, 3, 5}) {
+            if (p >= lo && p < hi) {
+                callback(p);
+                found++;
+            }
+        }
+        return found;
+    }
+
+    Plan prepare(uint64_t lo, uint64_t hi) const {
+        Plan plan;
+        plan.lo = max<uint64_t>(lo, 7);
+        plan.hi = max(hi, plan.lo);
+        plan.base = plan.lo / 30 * 30;
+        plan.chunk_bytes = segment * CHUNK_SEGMENTS;
+        uint64_t bytes = (plan.hi - plan.base + 29) / 30;
+        plan.chunks = (bytes + plan.chunk_bytes - 1) / plan.chunk_bytes;
+        if (plan.chunks) plan.primes = sievingPrimes(isqrt64(plan.hi - 1));
+        return plan;
+    }
+
+    static uint64_t isqrt64(uint64_t n) {
+        uint64_t r = (uint64_t)sqrtl((long double)n);
+        while (r * r > n) r--;
+        while (r < 0xFFFFFFFF && (r + 1) * (r + 1) <= n) r++;  // (r + 1)^2 wraps past 2^32 - 1
+        return r;
+    }
+
+    static void advance(Crossing& c) {
+        // Moves c to its next multiple, stopping at 2^64 - 1 (past every range) rather than wrapping
+        uint64_t step = (uint64_t)c.prime * STEP[c.wheel];
+        if (__builtin_add_overflow(c.next, step, &c.next)) c.next = UINT64_MAX;
+        c.wheel = (c.wheel + 1) & 7;
+    }
+
+    static vector<uint32_t> sievingPrimes(uint64_t limit) {
+        // The primes from 7 up to limit: a plain sieve for small limits, the segmented sieve
+        // itself (one thread, needing only primes up to limit^(1/2)) for larger ones.
+        vector<uint32_t> primes;
+        if (limit < (1 << 20)) {
+            vector<bool> composite(limit + 1, false);
+            for (uint64_t p = 7; p <= limit; p++) {
+                if (composite[p] || p % 2 == 0 || p % 3 == 0 || p % 5 == 0) continue;
+                primes.push_back(p);
+                for (uint64_t q = p * p; q <= limit; q += p) composite[q] = true;
+            }
+        } else {
+            SegmentedSieve(1).forEach(7, limit + 1, [&](uint64_t p) { primes.push_back(p); });
+        }
+        return primes;
+    }
+
+    size_t sieveChunk(const Plan& plan, size_t chunk, uint8_t* bits) const {
+        /*
+        Desc: Sieves one chunk, a segment at a time, and clears the bits outside [lo, hi).
+        Parameters:
+            plan (const Plan&): The range and its sieving primes.
+            chunk (size_t): Index of the chunk.
+            bits (uint8_t*): chunk_bytes bytes receiving the sieve.
+        Returns:
+            size_t: Number of bytes of the chunk inside the range.
+        */
+        uint64_t chunk_lo = plan.base + chunk * plan.chunk_bytes * 30;
+        uint64_t chunk_hi = chunk_lo + min<uint64_t>(plan.hi - chunk_lo, plan.chunk_bytes * 30);
+        size_t bytes = (chunk_hi - chunk_lo + 29) / 30;
+        uint64_t span = segment * 30;
+
+        // Primes striking a segment more than once are walked every segment; the rest go into a
+        // ring of buckets indexed by the segment of their next multiple.
+        vector<Crossing> dense;
+        size_t ring = 6 * (plan.primes.empty() ? 0 : plan.primes.back()) / span + 2;
+        vector<vector<Crossing>> buckets(ring);
+        vector<Crossing> due;  // The bucket of the current segment
+        for (uint32_t p : plan.primes) {
+            // First multiple p * q >= max(p^2, chunk_lo) with q coprime to 30
+            uint64_t q = max<uint64_t>(p, chunk_lo / p + (chunk_lo % p != 0));
+            while (BIT[q % 30] == 8) q++;
+            if (q > (plan.hi - 1) / p) continue;  // p * q is past the range, or past 2^64
+            Crossing c = {p * q, p, BIT[q % 30]};
+            if (c.next >= chunk_hi) continue;
+            if (2 * (uint64_t)p <= span) dense.push_back(c);
+            else buckets[(c.next - chunk_lo) / span % ring].push_back(c);
+        }
+
+        for (uint64_t seg_lo = chunk_lo, seg_hi, s = 0; seg_lo < chunk_hi; seg_lo = seg_hi, s++) {
+            seg_hi = seg_lo + min(chunk_hi - seg_lo, span);
+            uint8_t* seg = bits + (seg_lo - chunk_lo) / 30;
+            memset(seg, 0xff, (seg_hi - seg_lo + 29) / 30);
+            for (Crossing& c : dense) {
+                while (c.next < seg_hi) {
+                    uint64_t off = c.next - seg_lo;
+                    seg[off / 30] &= ~(1u << BIT[off % 30]);
+                    advance(c);
+                }
+            }
+            due.clear();
+            swap(due, buckets[s % ring]);
+            for (Crossing c : due) {
+                // A first multiple (p^2) further ahead than the ring only passes through here
+                if (c.next >= seg_hi) {
+                    buckets[(c.next - chunk_lo) / span % ring].push_back(c);
+                    continue;
+                }
+                uint64_t off = c.next - seg_lo;
+                seg[off / 30] &= ~(1u << BIT[off % 30]);
+                advance(c);
+                if (c.next < chunk_hi) buckets[(c.next - chunk_lo) / span % ring].push_back(c);
+            }
+        }
+
+        // The ends of the range rarely fall on a byte boundary (compared by differences, as the
+        // last byte may reach past 2^64)
+        uint64_t last = chunk_lo + (bytes - 1) * 30;
+        for (int i = 0; i < 8; i++) {
+            if (chunk_lo < plan.lo && WHEEL[i] < plan.lo - chunk_lo) bits[0] &= ~(1u << i);
+            if (WHEEL[i] >= plan.hi - last) bits[bytes - 1] &= ~(1u << i);
+        }
+        return bytes;
+    }
+};
+
+void tuneMultiplication() {
+    /*
+    Desc: Times one level of each multiplication and squaring algorithm at a range of sizes,
+            to find the crossover thresholds compiled into BigInt.
+    */
+    mt19937_64 gen(777);
+    const size_t sizes[] = {8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+    auto timeIt = [](auto&& fn) {
+        // Microseconds per call, repeating until at least 20 ms have passed.
+        int reps = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            fn();
+            reps++;
+            elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < 20000);
+        return elapsed / reps;
+    };
+
+    size_t karatsuba_mul = 0, karatsuba_sqr = 0, toom3_mul = 0, toom3_sqr = 0;
+    cout << "Limbs   mul: school  karatsuba    toom3 (us)   sqr: school  karatsuba    toom3 (us)" << endl;
+    for (size_t n : sizes) {
+        vector<uint64_t> a(n), b(n), r(2 * n);
+        for (size_t i = 0; i < n; i++) {
+            a[i] = gen();
+            b[i] = gen();
+        }
+        double mb = timeIt([&] { BigInt::mulBasecase(r.data(), a.data(), n, b.data(), n); });
+        double mk = timeIt([&] { BigInt::mulKaratsuba(r.data(), a.data(), b.data(), n); });
+        double mt = timeIt([&] { BigInt::mulToom3(r.data(), a.data(), b.data(), n); });
+        double sb = timeIt([&] { BigInt::sqrBasecase(r.data(), a.data(), n); });
+        double sk = timeIt([&] { BigInt::sqrKaratsuba(r.data(), a.data(), n); });
+        double st = timeIt([&] { BigInt::sqrToom3(r.data(), a.data(), n); });
+        cout << setw(5) << n << fixed << setprecision(2) << setw(17) << mb << setw(11) << mk << setw(9) << mt
+             << setw(19) << sb << setw(11) << sk << setw(9) << st << endl;
+
+        // A threshold is the first size from which the faster algorithm keeps winning.
+        if (mk < mb) { if (!karatsuba_mul) karatsuba_mul = n; } else karatsuba_mul = 0;
+        if (sk < sb) { if (!karatsuba_sqr) karatsuba_sqr = n; } else karatsuba_sqr = 0;
+        if (mt < mk) { if (!toom3_mul) toom3_mul = n; } else toom3_mul = 0;
+        if (st < sk) { if (!toom3_sqr) toom3_sqr = n; } else toom3_sqr = 0;
+    }
+    cout << "Suggested: KARATSUBA_MUL_THRESHOLD = " << karatsuba_mul << ", KARATSUBA_SQR_THRESHOLD = "
+         << karatsuba_sqr << ", TOOM3_MUL_THRESHOLD = " << toom3_mul << ", TOOM3_SQR_THRESHOLD = "
+         << toom3_sqr << " (0: never within the sizes tried)" << endl;
+}
+
+volatile uint64_t benchmarkSink; // Keeps benchmarked results from being optimized away
+
+// Optional count of every heap allocation, so the benchmark can show that the arithmetic has
+// stopped allocating. Build with -DCOUNT_ALLOCATIONS to replace operator new with a counting one;
+// without it the allocator is left alone and the allocation benchmark is skipped.
+#ifdef COUNT_ALLOCATIONS
+atomic<uint64_t> heapAllocations{0};
+
+void* operator new(size_t bytes) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(bytes ? bytes : 1)) return p;
+    throw bad_alloc();
+}
+
+// Kept out of line: inlined, the free() would meet the operator new at each call site and set off
+// a false -Wmismatched-new-delete warning.
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
+
+template <size_t Bits>
+double timeFixedModexp(const BigInt& base, const BigInt& exp, const BigInt& mod, int reps) {
+    // Milliseconds per fixed-width windowed modexp.
+    FixedMontgomery<Bits> ctx(mod);
+    auto mbase = ctx.toMontgomery(base);
+    auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) benchmarkSink = ctx.powerMontgomery(mbase, exp).data()[0];
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() / reps;
+}
+
+void benchmarkModexp(const vector<int>& sizes) {
+    /*
+    Desc: Times one modular exponentiation with a full-size exponent, reducing by division,
+            in Montgomery form with binary exponentiation, in Montgomery form with a sliding
+            window, and with the fixed-width window where the size has one.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths of the modulus to benchmark.
+    */
+    mt19937_64 gen(54321);
+    cout << "Bits   Division (ms)   Binary (ms)   Window (ms)   Fixed (ms)" << endl;
+    for (int bits : sizes) {
+        BigInt mod = randomOddNumber(bits, gen);
+        BigInt base = randomOddNumber(bits - 1, gen);
+        BigInt exp = randomOddNumber(bits, gen);
+        int reps = max(1, 200000 / bits);
+
+        MontgomeryContext ctx(mod);
+        LimbVector mbase = ctx.toMontgomery(base);
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < reps; i++) benchmarkSink = LargeNumber::powerByDivision(base, exp, mod).low();
+        auto t1 = chrono::steady_clock::now();
+        for (int i = 0; i < reps; i++) benchmarkSink = ctx.powerBinary(mbase, exp).data()[0];
+        auto t2 = chrono::steady_clock::now();
+        for (int i = 0; i < reps; i++) benchmarkSink = ctx.powerMontgomery(mbase, exp).data()[0];
+        auto t3 = chrono::steady_clock::now();
+
+        double fixed_width = -1;
+        if (bits == 512) fixed_width = timeFixedModexp<512>(base, exp, mod, reps);
+        if (bits == 1024) fixed_width = timeFixedModexp<1024>(base, exp, mod, reps);
+        if (bits == 2048) fixed_width = timeFixedModexp<2048>(base, exp, mod, reps);
+        if (bits == 4096) fixed_width = timeFixedModexp<4096>(base, exp, mod, reps);
+
+        double division = chrono::duration<double, milli>(t1 - t0).count() / reps;
+        double binary = chrono::duration<double, milli>(t2 - t1).count() / reps;
+        double window = chrono::duration<double, milli>(t3 - t2).count() / reps;
+        cout << setw(4) << bits << setw(16) << fixed << setprecision(3) << division << setw(14) << binary
+             << setw(14) << window << setw(13);
+        if (fixed_width >= 0) cout << fixed_width; else cout << "-";
+        cout << endl;
+    }
+}
+
+void benchmarkKernels(const vector<int>& sizes) {
+    /*
+    Desc: Measures Montgomery multiplies per second of the scalar 64-bit code and of each
+            vector kernel the CPU supports.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths of the modulus to benchmark.
+    */
+    mt19937_64 gen(999);
+    cout << "Active kernel: " << mulKernelName(activeMulKernel) << endl;
+    cout << "Bits   scalar (Mmul/s)   avx2 (Mmul/s)   avx512-ifma (Mmul/s)" << endl;
+    auto rate = [](auto&& ctx, const BigInt& a, const BigInt& b) {
+        auto x = ctx.toMontgomery(a), y = ctx.toMontgomery(b);
+        int reps = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            for (int i = 0; i < 1000; i++) ctx.mul(x.data(), x.data(), y.data());
+            reps += 1000;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.2);
+        benchmarkSink = x.data()[0];
+        return reps / elapsed / 1e6;
+    };
+    for (int bits : sizes) {
+        BigInt mod = randomOddNumber(bits, gen);
+        BigInt a = randomOddNumber(bits - 1, gen), b = randomOddNumber(bits - 1, gen);
+        cout << setw(4) << bits << fixed << setprecision(2) << setw(18) << rate(MontgomeryContext(mod), a, b);
+        if (activeMulKernel >= KERNEL_AVX2 && (size_t)bits <= simdMaxBits(KERNEL_AVX2)) {
+            cout << setw(16) << rate(SimdMontgomery(mod, KERNEL_AVX2), a, b);
+        } else {
+            cout << setw(16) << "-";
+        }
+        if (activeMulKernel >= KERNEL_AVX512_IFMA && (size_t)bits <= simdMaxBits(KERNEL_AVX512_IFMA)) {
+            cout << setw(23) << rate(SimdMontgomery(mod, KERNEL_AVX512_IFMA), a, b);
+        } else {
+            cout << setw(23) << "-";
+        }
+        cout << endl;
+    }
+}
+
+void benchmarkReduction(const vector<int>& sizes) {
+    /*
+    Desc: Measures products of plain residues reduced per second, modulo one fixed n, by long
+            division, by Barrett reduction and by Montgomery multiplication (two products, the
+            second by R^2 to leave Montgomery form), and names the one ModularMultiplier uses.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths of the modulus to benchmark.
+    */
+    mt19937_64 gen(4343);
+    cout << "Bits   division (Kmul/s)   Barrett (Kmul/s)   Montgomery (Kmul/s)   Chosen" << endl;
+    auto rate = [](auto&& step) {
+        int reps = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            for (int i = 0; i < 100; i++) step();
+            reps += 100;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.2);
+        return reps / elapsed / 1e3;
+    };
+    for (int bits : sizes) {
+        BigInt mod = randomOddNumber(bits, gen);
+        BigInt a = randomOddNumber(bits - 1, gen), b = randomOddNumber(bits - 1, gen);
+        BarrettContext barrett(mod);
+        MontgomeryContext montgomery(mod);
+        LimbVector x = barrett.padded(a), y = barrett.padded(b), out = x;
+        double division = rate([&] { benchmarkSink = ((a * b) % mod).low(); });
+        double reduced = rate([&] {
+            barrett.mul(out.data(), x.data(), y.data());
+            benchmarkSink = out[0];
+        });
+        double converted = rate([&] {
+            montgomery.mul(out.data(), x.data(), y.data());
+            montgomery.mul(out.data(), out.data(), montgomery.r2.data());
+            benchmarkSink = out[0];
+        });
+        cout << setw(4) << bits << fixed << setprecision(0) << setw(20) << division << setw(19) << reduced
+             << setw(22) << converted << setw(9) << (ModularMultiplier(mod).barrett ? "Barrett" : "division") << endl;
+    }
+}
+
+void benchmarkMillerRabin(const vector<int>& sizes, int k) {
+    /*
+    Desc: Measures how many random odd candidates per second millerRabin() screens at each size,
+            and how long a full k-round test of a prime of that size takes.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+        k (int): Number of Miller-Rabin rounds.
+    */
+    mt19937_64 gen(12345);
+    cout << "Bits   Candidates/sec   Primes found   ms per prime (k=" << k << ")" << endl;
+    for (int bits : sizes) {
+        int tested = 0, primes = 0;
+        double prime_secs = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < 1.0) {
+            BigInt n = randomOddNumber(bits, gen);
+            auto t0 = chrono::steady_clock::now();
+            bool prime = LargeNumber::millerRabin(n, k);
+            auto t1 = chrono::steady_clock::now();
+            tested++;
+            if (prime) {
+                primes++;
+                prime_secs += chrono::duration<double>(t1 - t0).count();
+            }
+            elapsed = chrono::duration<double>(t1 - start).count();
+        }
+        cout << setw(4) << bits << setw(17) << fixed << setprecision(0) << tested / elapsed << setw(15) << primes
+             << setw(22) << setprecision(2) << (primes ? prime_secs * 1000 / primes : 0.0) << endl;
+    }
+}
+
+void benchmarkBatchedRounds(const vector<int>& sizes, int k) {
+    /*
+    Desc: Times a prime of each size through one Miller-Rabin round, k rounds run one after
+            another, and k rounds with the bases batched across vector lanes.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+        k (int): Number of Miller-Rabin rounds.
+    */
+    if (activeMulKernel != KERNEL_AVX512_IFMA) return;
+    mt19937_64 gen(777);
+    cout << "Bits   1 round ms   " << k << " sequential ms   " << k << " batched ms" << endl;
+    for (int bits : sizes) {
+        BigInt n = randomOddNumber(bits, gen);
+        while (!LargeNumber::millerRabin(n, 1)) n = randomOddNumber(bits, gen);
+
+        auto time = [&](auto&& run) {
+            int reps = 0;
+            auto start = chrono::steady_clock::now();
+            double elapsed = 0;
+            while (elapsed < 0.5) {
+                benchmarkSink = run();
+                reps++;
+                elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            }
+            return elapsed * 1000 / reps;
+        };
+        double one = time([&] { return LargeNumber::millerRabin(n, 1); });
+        double sequential = time([&] {
+            bool prime = true;
+            for (int i = 0; i < k; i++) prime = prime && LargeNumber::millerRabin(n, 1);
+            return prime;
+        });
+        double batched = time([&] { return LargeNumber::millerRabin(n, k); });
+        cout << setw(4) << bits << fixed << setprecision(2) << setw(13) << one << setw(17) << sequential
+             << setw(14) << batched << endl;
+    }
+}
+
+void benchmark64() {
+    /*
+    Desc: Measures the deterministic 64-bit test: random odd 64-bit numbers per second, and
+            tests per second on primes alone, which pay for all seven bases.
+    */
+    mt19937_64 gen(4242);
+    vector<uint64_t> mixed(1 << 20), primes;
+    for (uint64_t& x : mixed) x = gen() | 1 | (1ULL << 63);
+    for (uint64_t x : mixed) if (primes.size() < 4096 && LargeNumber::isPrime64(x)) primes.push_back(x);
+
+    auto rate = [](const vector<uint64_t>& numbers) {
+        // Tests per second, repeating the list until at least 0.5 s have passed.
+        size_t tested = 0, found = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            for (uint64_t x : numbers) found += LargeNumber::isPrime64(x);
+            tested += numbers.size();
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.5);
+        benchmarkSink = found;
+        return tested / elapsed / 1e6;
+    };
+    cout << "64-bit   random odd (M/s)   primes only (M/s)" << endl;
+    cout << setw(25) << fixed << setprecision(2) << rate(mixed) << setw(20) << rate(primes) << endl;
+}
+
+void benchmarkBailliePSW(const vector<int>& sizes, int k) {
+    /*
+    Desc: Times a prime of each size through k Miller-Rabin rounds and through Baillie-PSW.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+        k (int): Number of Miller-Rabin rounds.
+    */
+    mt19937_64 gen(1357);
+    cout << "Bits   MR k=" << k << " ms   BPSW ms" << endl;
+    for (int bits : sizes) {
+        BigInt n = randomOddNumber(bits, gen);
+        while (!LargeNumber::bailliePSW(n)) n = randomOddNumber(bits, gen);
+        auto time = [&](LargeNumber::Test test) {
+            int reps = 0;
+            auto start = chrono::steady_clock::now();
+            double elapsed = 0;
+            while (elapsed < 0.5) {
+                benchmarkSink = LargeNumber::isProbablePrime(n, test, k);
+                reps++;
+                elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            }
+            return elapsed * 1000 / reps;
+        };
+        cout << setw(4) << bits << fixed << setprecision(2) << setw(13) << time(LargeNumber::MILLER_RABIN)
+             << setw(10) << time(LargeNumber::BAILLIE_PSW) << endl;
+    }
+}
+
+void benchmarkRandomPrime(const vector<int>& sizes) {
+    /*
+    Desc: Times randomPrime() at each size, averaged over a number of primes.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+    */
+    cout << "Bits   ms per random prime (k=10)" << endl;
+    for (int bits : sizes) {
+        int made = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < 1.0 || made < 3) {
+            benchmarkSink = randomPrime(bits).low();
+            made++;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        cout << setw(4) << bits << setw(20) << fixed << setprecision(2) << elapsed * 1000 / made << endl;
+    }
+}
+
+void benchmarkSieve() {
+    /*
+    Desc: Times the segmented sieve counting the primes below 10^9 and in a window of 10^9 at
+            10^12, with L1- and L2-sized segments.
+    */
+    struct Range { uint64_t lo, hi; };
+    const Range ranges[] = {{0, 1000000000ULL}, {1000000000000ULL, 1001000000000ULL}};
+    cout << "Range                          Primes   L1 32K (s)   L2 256K (s)" << endl;
+    for (const Range& r : ranges) {
+        uint64_t found = 0;
+        double secs[2];
+        const size_t segment_bytes[] = {SegmentedSieve::SEGMENT_BYTES, 256 * 1024};
+        for (int i = 0; i < 2; i++) {
+            auto start = chrono::steady_clock::now();
+            found = SegmentedSieve(0, segment_bytes[i]).count(r.lo, r.hi);
+            secs[i] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        string name = "[" + to_string(r.lo) + ", " + to_string(r.hi) + ")";
+        cout << left << setw(29) << name << right << setw(11) << found << fixed << setprecision(3)
+             << setw(13) << secs[0] << setw(14) << secs[1] << endl;
+    }
+}
+
+void benchmarkParsing() {
+    /*
+    Desc: Times decimal parsing of random numbers of growing length, with the divide-and-conquer
+            fromDecimal() and with the direct leaf conversion applied to the whole string.
+    */
+    mt19937_64 gen(8080);
+    cout << "Digits   fromDecimal (ms)   direct (ms)" << endl;
+    for (size_t n : {1000, 10000, 100000, 1000000}) {
+        string digits(n, '0');
+        for (char& c : digits) c = '0' + gen() % 10;
+        digits[0] = '1' + gen() % 9;
+        auto t0 = chrono::steady_clock::now();
+        benchmarkSink = BigInt::fromDecimal(digits).low();
+        auto t1 = chrono::steady_clock::now();
+        benchmarkSink = BigInt::parseLeaf(digits.data(), n).low();
+        auto t2 = chrono::steady_clock::now();
+        cout << setw(7) << n << fixed << setprecision(2) << setw(19) << chrono::duration<double, milli>(t1 - t0).count()
+             << setw(14) << chrono::duration<double, milli>(t2 - t1).count() << endl;
+    }
+}
+
+void benchmarkPrinting() {
+    /*
+    Desc: Times decimal printing of random numbers of growing length, with the divide-and-conquer
+            toString() and with repeated division by 10^19 over the whole number.
+    */
+    mt19937_64 gen(9090);
+    cout << "Digits   toString (ms)   direct (ms)" << endl;
+    for (size_t n : {1000, 10000, 100000, 1000000}) {
+        string digits(n, '0');
+        for (char& c : digits) c = '0' + gen() % 10;
+        digits[0] = '1' + gen() % 9;
+        BigInt x = BigInt::fromDecimal(digits);
+        string direct(n + 19, '0');
+        auto t0 = chrono::steady_clock::now();
+        benchmarkSink = x.toString().size();
+        auto t1 = chrono::steady_clock::now();
+        BigInt::writeLeaf(x, direct.data(), direct.size());
+        benchmarkSink = direct.back();
+        auto t2 = chrono::steady_clock::now();
+        cout << setw(7) << n << fixed << setprecision(2) << setw(16) << chrono::duration<double, milli>(t1 - t0).count()
+             << setw(14) << chrono::duration<double, milli>(t2 - t1).count() << endl;
+    }
+}
+
+#ifdef COUNT_ALLOCATIONS
+void benchmarkAllocations(const vector<int>& sizes) {
+    /*
+    Desc: Counts the heap allocations of a modexp, a Miller-Rabin round and a strong Lucas test,
+            on the context withContext() picks and on the arbitrary-precision one. The first
+            round shows the warm-up (scratch blocks, cached limb blocks); the later columns
+            are measured once it is over and should read zero.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+    */
+    mt19937_64 gen(4242);
+    auto allocations = [](auto&& fn) {
+        uint64_t before = heapAllocations.load();
+        fn();
+        return heapAllocations.load() - before;
+    };
+    cout << "Bits   Context   First round   Modexp   MR round   Lucas   (heap allocations)" << endl;
+    for (int bits : sizes) {
+        BigInt n = randomOddNumber(bits, gen), nMinus1 = n - BigInt(1);
+        size_t s = nMinus1.trailingZeros();
+        BigInt d = nMinus1 >> s;
+        auto report = [&](const auto& ctx, const char* name) {
+            uint64_t first = allocations([&] { LargeNumber::millerRabinRounds(ctx, n, nMinus1, d, s, 1); });
+            auto base = ctx.toMontgomery(BigInt(3));
+            benchmarkSink = ctx.powerMontgomery(base, d).data()[0];
+            benchmarkSink = LargeNumber::strongLucas(ctx, n, 5);
+            uint64_t modexp = allocations([&] { benchmarkSink = ctx.powerMontgomery(base, d).data()[0]; });
+            uint64_t round = allocations([&] { LargeNumber::millerRabinRounds(ctx, n, nMinus1, d, s, 1); });
+            uint64_t lucas = allocations([&] { benchmarkSink = LargeNumber::strongLucas(ctx, n, 5); });
+            cout << setw(5) << bits << setw(10) << name << setw(14) << first << setw(9) << modexp << setw(11)
+                 << round << setw(8) << lucas << endl;
+            return true;
+        };
+        LargeNumber::withContext(n, [&](const auto& ctx) { return report(ctx, "auto"); });
+        report(MontgomeryContext(n), "generic");
+    }
+}
+#endif
+
+void benchmarkCache(const vector<int>& sizes) {
+    /*
+    Desc: Times a 10-round test of the sieved candidates in a range, first answered by testing
+            and stored in a fresh cache file, then answered again from the cache.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+    */
+    string path = (filesystem::temp_directory_path() / "p2-bench.cache").string();
+    mt19937_64 gen(5050);
+    cout << "Bits   Numbers   tested (us each)   cached (us each)" << endl;
+    for (int bits : sizes) {
+        filesystem::remove(path);
+        PrimalityCache cache;
+        cache.open(path, 1 << 12);
+        vector<BigInt> numbers;
+        while (numbers.size() < 200) {
+            BigInt n = randomOddNumber(bits, gen);
+            if (LargeNumber::prefilter().check(n) == TrialDivisionFilter::PASSED) numbers.push_back(n);
+        }
+        auto t0 = chrono::steady_clock::now();
+        for (const BigInt& n : numbers) {
+            bool prime = LargeNumber::millerRabin(n, 10);
+            cache.store(n, PrimalityCache::Entry{prime, uint8_t(LargeNumber::MILLER_RABIN), 10});
+        }
+        auto t1 = chrono::steady_clock::now();
+        PrimalityCache::Entry entry;
+        for (const BigInt& n : numbers) benchmarkSink = cache.lookup(n, entry) && entry.prime;
+        auto t2 = chrono::steady_clock::now();
+        cout << setw(4) << bits << setw(10) << numbers.size() << fixed << setprecision(2) << setw(19)
+             << chrono::duration<double, micro>(t1 - t0).count() / numbers.size() << setw(19)
+             << chrono::duration<double, micro>(t2 - t1).count() / numbers.size() << endl;
+    }
+    filesystem::remove(path);
+}
+
+void benchmarkPrefilter(const vector<int>& sizes) {
+    /*
+    Desc: Measures, for several trial division depths, the share of random odd candidates the
+            prefilter rejects and how many candidates per second a 10-round millerRabin() screens.
+    Parameters:
+        sizes (const vector<int>&): Bit lengths to benchmark.
+    */
+    TrialDivisionFilter& filter = LargeNumber::prefilter();
+    uint32_t configured = filter.depth();
+    const uint32_t depths[] = {0, 100, 1000, 10000, 100000};
+    mt19937_64 gen(2468);
+    cout << "Bits   Depth   Rejected (%)   Candidates/sec" << endl;
+    for (int bits : sizes) {
+        for (uint32_t depth : depths) {
+            filter.setLimit(depth);
+            int tested = 0;
+            auto start = chrono::steady_clock::now();
+            double elapsed = 0;
+            while (elapsed < 0.5) {
+                benchmarkSink = LargeNumber::millerRabin(randomOddNumber(bits, gen), 10);
+                tested++;
+                elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            }
+            cout << setw(4) << bits << setw(8) << depth << setw(15) << fixed << setprecision(1)
+                 << filter.rejectionRate() * 100 << setw(17) << setprecision(0) << tested / elapsed << endl;
+        }
+    }
+    filter.setLimit(configured);
+}
+
+bool parseArgument(const string& text, uint64_t lo, uint64_t hi, uint64_t& value) {
+    /*
+    Desc: Parses a numeric command line argument strictly: decimal digits only, so a sign, a
+            suffix or an empty string is refused rather than wrapped or ignored as stoul() would.
+    Parameters:
+        text (const string&): The argument.
+        lo (uint64_t), hi (uint64_t): Smallest and largest value accepted.
+        value (uint64_t&): Receives the number.
+    Returns:
+        bool: True if the argument is a number in [lo, hi].
+    */
+    if (text.empty() || !BigInt::allDigits(text.data(), text.size())) return false;
+    try {
+        value = stoull(text);
+    } catch (const out_of_range&) {
+        return false;
+    }
+    return value >= lo && value <= hi;
+}
+
+int main(int argc, char* argv[]) {
+    // Benchmark mode: p2 --bench [bits...]
+    // Tuning mode:    p2 --tune
+    // Batch mode:     p2 --batch [k] [threads] < numbers, one verdict per line in input order
+    // Parallel mode:  p2 --parallel [k] [threads] < number, rounds of one huge number across threads
+    // Next prime:     p2 --next < number, the next probable prime after the number
+    // Random primes:  p2 --random <bits> [count], random probable primes of the given size
+    // Prime count:    p2 --count <lo> <hi> [threads], number of primes in [lo, hi)
+    // Prime listing:  p2 --primes <lo> <hi> [threads], every prime in [lo, hi), one per line
+    // Any mode may be preceded by these options:
+    //   --prefilter <limit>  trial divide by the odd primes below limit, at most 2^20 (0 turns the
+    //                        prefilter off)
+    //   --test mr|bpsw       Miller-Rabin with k random bases (the default) or Baillie-PSW, for the
+    //                        interactive, batch, next and random modes
+    //   --cache <file>       keep verdicts in a memory-mapped file and reuse them across runs, for
+    //                        the interactive and batch modes
+    LargeNumber::Test test = LargeNumber::MILLER_RABIN;
+    while (argc > 2 && (string(argv[1]) == "--prefilter" || string(argv[1]) == "--test" ||
+                        string(argv[1]) == "--cache")) {
+        string option = argv[1], value = argv[2];
+        try {
+            uint64_t limit;
+            if (option == "--prefilter") {
+                // stoul() would wrap "-1" to 2^64 - 1 and build tables for billions of numbers
+                if (!parseArgument(value, 0, TrialDivisionFilter::MAX_LIMIT, limit)) throw out_of_range(value);
+                LargeNumber::prefilter().setLimit(limit);
+            } else if (option == "--cache") {
+                LargeNumber::resultCache().open(value);
+            } else if (value == "bpsw") {
+                test = LargeNumber::BAILLIE_PSW;
+            } else if (value == "mr") {
+                test = LargeNumber::MILLER_RABIN;
+            } else {
+                throw invalid_argument("unknown test: " + value);
+            }
+        } catch (const logic_error&) {
+            // A malformed or out of range depth, or an unknown test name
+            cerr << "invalid value for " << option << ": " << value << endl;
+            cerr << "usage: p2 [--prefilter <limit>] [--test mr|bpsw] [--cache <file>] [mode [arguments]]" << endl;
+            return 1;
+        } catch (const runtime_error& e) {
+            // The cache file could not be opened or mapped, or is not a cache
+            cerr << e.what() << endl;
+            return 1;
+        }
+        argv[2] = argv[0];
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc > 1 && string(argv[1]) == "--tune") {
+        tuneMultiplication();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        vector<int> sizes;
+        for (int i = 2; i < argc; i++) sizes.push_back(stoi(argv[i]));
+        if (sizes.empty()) sizes = {1024, 2048, 4096};
+        benchmark64();
+        benchmarkMillerRabin(sizes, 10);
+        benchmarkPrefilter(sizes);
+        benchmarkBailliePSW(sizes, 10);
+        benchmarkRandomPrime(sizes);
+        benchmarkSieve();
+        benchmarkParsing();
+        benchmarkPrinting();
+#ifdef COUNT_ALLOCATIONS
+        benchmarkAllocations({512, 1024, 2048, 4096, 8192});
+#endif
+        benchmarkCache(sizes);
+        benchmarkBatchedRounds(sizes, 10);
+        benchmarkModexp(sizes);
+        benchmarkKernels(sizes);
+        benchmarkReduction({64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384});
+        return 0;
+    }
+
+    // The batch and parallel modes take [k] [threads]: at least one round (k = 0 or less would
+    // call every number prime), and 0 threads for one per hardware thread
+    uint64_t rounds = 10, threads = 0;
+    if (argc > 1 && (string(argv[1]) == "--batch" || string(argv[1]) == "--parallel")) {
+        if ((argc > 2 && !parseArgument(argv[2], 1, INT_MAX, rounds)) ||
+            (argc > 3 && !parseArgument(argv[3], 0, UINT_MAX, threads))) {
+            cerr << "invalid arguments for " << argv[1] << endl;
+            cerr << "usage: p2 " << argv[1] << " [k >= 1] [threads]" << endl;
+            return 1;
+        }
+    }
+
+    if (argc > 1 && string(argv[1]) == "--batch") {
+        vector<BigInt> numbers;
+        string line, numberStr;
+        for (size_t lineNumber = 1; getline(cin, line); lineNumber++) {
+            istringstream fields(line);
+            while (fields >> numberStr) {
+                try {
+                    numbers.push_back(BigInt::fromDecimal(numberStr));
+                } catch (const invalid_argument& e) {
+                    // Skipping the line would shift every later verdict off its input line
+                    cerr << "line " << lineNumber << ": " << e.what() << endl;
+                    return 1;
+                }
+            }
+        }
+
+        auto start = chrono::steady_clock::now();
+        vector<LargeNumber::Result> results = LargeNumber::testMany(numbers, rounds, threads, test);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        string out;
+        for (const LargeNumber::Result& r : results) out += r.probably_prime ? "prime\n" : "composite\n";
+        cout << out;
+        cerr << numbers.size() << " numbers in " << fixed << setprecision(3) << elapsed << " s ("
+             << setprecision(0) << numbers.size() / max(elapsed, 1e-9) << "/s)";
+        if (LargeNumber::prefilter().checked()) {
+            // Numbers below 2^64 take the deterministic path and skip the prefilter
+            cerr << ", " << setprecision(1) << LargeNumber::prefilter().rejectionRate() * 100
+                 << "% rejected by trial division below " << LargeNumber::prefilter().depth();
+        }
+        if (LargeNumber::resultCache().isOpen()) cerr << ", " << LargeNumber::resultCache().hitCount() << " cache hits";
+        cerr << endl;
+        return 0;
+    }
+
+    if (argc > 1 && string(argv[1]) == "--parallel") {
+        string numberStr;
+        cin >> numberStr;
+        BigInt n;
+        try {
+            n = BigInt::fromDecimal(numberStr);
+        } catch (const invalid_argument& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+
+        auto start = chrono::steady_clock::now();
+        bool prime = LargeNumber::millerRabinParallel(n, rounds, threads);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << (prime ? "The number is probably prime." : "The number is composite.") << endl;
+        cerr << rounds << " rounds in " << fixed << setprecision(3) << elapsed << " s" << endl;
+        return 0;
+    }
+
+    if (argc > 1 && string(argv[1]) == "--next") {
+        string numberStr;
+        cin >> numberStr;
+        BigInt n;
+        try {
+            n = BigInt::fromDecimal(numberStr);
+        } catch (const invalid_argument& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        cout << nextPrime(n, 10, test).toString() << endl;
+        return 0;
+    }
+
+    if (argc > 2 && string(argv[1]) == "--random") {
+        // A prime needs at least 2 bits
+        uint64_t bits, count = 1;
+        if (!parseArgument(argv[2], 2, UINT32_MAX, bits) ||
+            (argc > 3 && !parseArgument(argv[3], 0, INT_MAX, count))) {
+            cerr << "invalid arguments for --random" << endl;
+            cerr << "usage: p2 --random <bits >= 2> [count]" << endl;
+            return 1;
+        }
+        auto start = chrono::steady_clock::now();
+        for (uint64_t i = 0; i < count; i++) cout << randomPrime(bits, 10, test).toString() << endl;
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << count << " primes in " << fixed << setprecision(3) << elapsed << " s" << endl;
+        return 0;
+    }
+
+    if (argc > 3 && (string(argv[1]) == "--count" || string(argv[1]) == "--primes")) {
+        uint64_t lo, hi, threads = 0;
+        if (!parseArgument(argv[2], 0, UINT64_MAX, lo) || !parseArgument(argv[3], 0, UINT64_MAX, hi) ||
+            (argc > 4 && !parseArgument(argv[4], 0, UINT_MAX, threads))) {
+            cerr << "invalid arguments for " << argv[1] << endl;
+            cerr << "usage: p2 " << argv[1] << " <lo> <hi> [threads]" << endl;
+            return 1;
+        }
+        SegmentedSieve sieve(threads);
+        auto start = chrono::steady_clock::now();
+        if (string(argv[1]) == "--count") {
+            cout << sieve.count(lo, hi) << endl;
+        } else {
+            string out;
+            sieve.forEach(lo, hi, [&](uint64_t p) {
+                out += to_string(p);
+                out += '\n';
+                if (out.size() > (1 << 16)) {
+                    cout << out;
+                    out.clear();
+                }
+            });
+            cout << out;
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << "[" << lo << ", " << hi << ") sieved in " << fixed << setprecision(3) << elapsed << " s" << endl;
+        return 0;
+    }
+
     // Input number as a string
     cout << "Enter a number to check for primality: ";
     string numberStr;
     cin >> numberStr;
 
-    // Create LargeNumber instance and populate it with chunks
-    vector<uint64_t> numberChunks = splitNumberIntoChunks(numberStr, 19); // Split the input number into 19-digit chunks
+    // Create LargeNumber instance from the digits
     LargeNumber number;
-    for (const uint64_t& chunk : numberChunks) {
-        number.addChunk(chunk); // Add each chunk to the LargeNumber
+    try {
+        number = LargeNumber(numberStr);
+    } catch (const invalid_argument& e) {
+        cerr << e.what() << endl;
+        return 1;
     }
 
     // Perform Miller-Rabin primality test
     int k = 10; // Number of rounds (more rounds = higher confidence in result)
-    if (number.millerRabin(k)) {
+    if (LargeNumber::isProbablePrimeCached(number.value, test, k)) {
         cout << "The number is probably prime." << endl;
     } else {
         cout << "The number is composite." << endl;